@@ -0,0 +1,251 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "capture.h"
+
+/* ------------------------------- Constants -------------------------------- */
+
+#define PRINT_CAPTURE_ERROR(str) perror("CAPTURE ERROR: " str)
+
+#define NSEC_PER_SEC 1000000000ULL
+
+/* Size of the buffer used for the capture file, so that the disk is accessed
+ * once per many records */
+#define CAPTURE_FILE_BUFFER (4UL << 20)
+
+/* Time given to the writer to stop and to producers to complete the bursts
+ * they are capturing before rings are drained for the last time [us] */
+#define CAPTURE_STOP_WAIT_US 100000
+#define CAPTURE_STOP_GRACE_US 1000
+
+/* --------------------------- Private Functions ---------------------------- */
+
+/**
+ * Converts a TSC value to the wall-clock time, split in seconds and
+ * nanoseconds as needed by pcap records.
+ * */
+static inline void capture_timestamp(struct capture *capture, tsc_t tsc,
+                                     struct pcap_rec_hdr *rec) {
+    tsc_t elapsed = tsc - capture->tsc_base;
+    uint64_t ns = capture->ns_base +
+                  (elapsed / capture->tsc_hz) * NSEC_PER_SEC +
+                  (elapsed % capture->tsc_hz) * NSEC_PER_SEC / capture->tsc_hz;
+
+    rec->ts_sec = ns / NSEC_PER_SEC;
+    rec->ts_nsec = ns % NSEC_PER_SEC;
+}
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+/**
+ * Creates the capture file given in the configuration and the rings of all
+ * the threads running the same loop. Does nothing if capture is not enabled.
+ *
+ * Shall be invoked after tsc_init and before per-thread copies of the
+ * configuration are made.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+int capture_init(struct config *conf) {
+    struct capture *capture;
+    struct timespec now;
+    const struct pcap_file_hdr file_hdr = {
+        .magic = PCAP_MAGIC_NSEC,
+        .version_major = PCAP_VERSION_MAJOR,
+        .version_minor = PCAP_VERSION_MINOR,
+        .thiszone = 0,
+        .sigfigs = 0,
+        .snaplen = CAPTURE_SNAPLEN,
+        .linktype = PCAP_LINKTYPE_ETHERNET,
+    };
+
+    if (conf->capture.path == NULL)
+        return 0;
+
+    capture = calloc(1, sizeof(*capture));
+    if (capture == NULL) {
+        PRINT_CAPTURE_ERROR("could not allocate capture");
+        return -1;
+    }
+
+    capture->nb_rings = conf->num_threads;
+    for (unsigned int i = 0; i < capture->nb_rings; ++i) {
+        // Not from hugepages, since DPDK may not be initialized at all
+        capture->rings[i] = aligned_alloc(RTE_CACHE_LINE_SIZE,
+                                          sizeof(struct capture_ring));
+        if (capture->rings[i] == NULL) {
+            PRINT_CAPTURE_ERROR("could not allocate ring");
+            goto error_free;
+        }
+
+        memset(capture->rings[i], 0, sizeof(struct capture_ring));
+
+        capture->rings[i]->sampling = conf->capture.sampling;
+        capture->rings[i]->countdown = 1;
+    }
+
+    capture->file = fopen(conf->capture.path, "w");
+    if (capture->file == NULL) {
+        PRINT_CAPTURE_ERROR("could not open capture file");
+        goto error_free;
+    }
+
+    setvbuf(capture->file, NULL, _IOFBF, CAPTURE_FILE_BUFFER);
+
+    if (fwrite(&file_hdr, sizeof(file_hdr), 1, capture->file) != 1) {
+        PRINT_CAPTURE_ERROR("could not write capture file");
+        goto error_close;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    capture->tsc_hz = tsc_get_hz();
+    capture->tsc_base = tsc_read();
+    capture->ns_base = now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+
+    conf->capture.capture = capture;
+    return 0;
+
+error_close:
+    fclose(capture->file);
+error_free:
+    for (unsigned int i = 0; i < capture->nb_rings; ++i)
+        free(capture->rings[i]);
+    free(capture);
+    return -1;
+}
+
+/**
+ * Returns the ring the thread owning the given configuration shall capture
+ * packets to, NULL if capture is not enabled.
+ * */
+struct capture_ring *capture_ring_attach(struct config *conf) {
+    struct capture_ring *ring;
+
+    if (conf->capture.capture == NULL)
+        return NULL;
+
+    ring = conf->capture.capture->rings[conf->thread_id];
+    pkt_hdr_setup(&ring->hdr, conf, DIR_INCOMING);
+
+    return ring;
+}
+
+/**
+ * Writes to the capture file all the frames currently in the rings. After a
+ * write error (e.g. a full disk) frames are still consumed, but only counted
+ * as lost.
+ *
+ * \return the number of frames written.
+ * */
+static size_t capture_drain(struct capture *capture) {
+    struct capture_ring *ring;
+    struct capture_slot *slot;
+    uint64_t head, tail;
+    size_t written = 0;
+
+    for (unsigned int i = 0; i < capture->nb_rings; ++i) {
+        ring = capture->rings[i];
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+        for (tail = ring->tail; tail != head; ++tail) {
+            slot = &ring->slots[tail & (CAPTURE_RING_SIZE - 1)];
+
+            if (unlikely(capture->failed)) {
+                ++capture->lost;
+                continue;
+            }
+
+            capture_timestamp(capture, slot->tsc, &slot->rec);
+
+            // Record header and frame are contiguous
+            if (unlikely(fwrite(&slot->rec,
+                                sizeof(slot->rec) + slot->rec.caplen, 1,
+                                capture->file) != 1)) {
+                PRINT_CAPTURE_ERROR("could not write capture file");
+                capture->failed = true;
+                ++capture->lost;
+                continue;
+            }
+
+            ++written;
+        }
+
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+
+    capture->written += written;
+    return written;
+}
+
+/**
+ * Writes to the capture file all the frames currently in the rings. Shall be
+ * invoked by a single thread, which is the only one accessing the disk, until
+ * capture_close takes over.
+ *
+ * \return the number of frames written, -1 once the capture is being closed.
+ * */
+ssize_t capture_write(struct capture *capture) {
+    if (unlikely(__atomic_load_n(&capture->stop, __ATOMIC_ACQUIRE))) {
+        __atomic_store_n(&capture->writer_stopped, true, __ATOMIC_RELEASE);
+        return -1;
+    }
+
+    return capture_drain(capture);
+}
+
+/**
+ * Stops capturing, writes to the capture file the frames still in the rings,
+ * closes it and prints how many frames were captured.
+ *
+ * Invoked on termination, from any thread: the writer is stopped before the
+ * rings are drained, so that only one thread accesses them.
+ * */
+void capture_close(struct capture *capture) {
+    uint64_t dropped = 0;
+    unsigned int waited = 0;
+
+    for (unsigned int i = 0; i < capture->nb_rings; ++i)
+        __atomic_store_n(&capture->rings[i]->stop, true, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&capture->stop, true, __ATOMIC_RELEASE);
+
+    while (!__atomic_load_n(&capture->writer_stopped, __ATOMIC_ACQUIRE) &&
+           waited < CAPTURE_STOP_WAIT_US) {
+        usleep(10);
+        waited += 10;
+    }
+
+    usleep(CAPTURE_STOP_GRACE_US);
+
+    // The writer may not stop if it is the thread running this function
+    if (__atomic_load_n(&capture->writer_stopped, __ATOMIC_ACQUIRE))
+        capture_drain(capture);
+    else
+        fprintf(stderr, "CAPTURE ERROR: writer did not stop, frames still "
+                        "queued are not written\n");
+
+    if (fclose(capture->file) != 0 && !capture->failed) {
+        PRINT_CAPTURE_ERROR("could not write capture file");
+        capture->failed = true;
+    }
+
+    for (unsigned int i = 0; i < capture->nb_rings; ++i)
+        dropped += capture->rings[i]->dropped;
+
+    printf("-------------------------------------\n");
+    printf("CAPTURE\n");
+    printf("written\t\t%lu\n", capture->written);
+    printf("dropped\t\t%lu\n", dropped);
+    if (capture->failed)
+        printf("lost\t\t%lu (write errors, file incomplete)\n",
+               capture->lost);
+}
@@ -6,10 +6,14 @@
 #include <stdbool.h>
 #include <unistd.h>
 
+#include "capture.h"
 #include "commands.h"
 #include "config.h"
 #include "constants.h"
 #include "loops.h"
+#include "pacer.h"
+#include "replay.h"
+#include "search.h"
 #include "threads.h"
 
 static const struct config_defaults defaults_server = {
@@ -92,11 +96,85 @@ static inline core_t check_cores(struct config *conf,
     return *needed_cores;
 }
 
+/**
+ * Initializes the configuration of the peer side of a loopback test, which is
+ * the mirror image of the local one.
+ * */
+static inline void config_peer(struct config *peer,
+                               const struct config *conf) {
+    *peer = *conf;
+    peer->local = conf->remote;
+    peer->remote = conf->local;
+    peer->dpdk.portid = conf->dpdk.peer_portid;
+    peer->is_peer = true;
+}
+
+/**
+ * Tells whether any of the given loops is either body_a or body_b.
+ * */
+static inline bool loops_include(const thread_body_t loops[],
+                                 const int howmany_loops, thread_body_t body_a,
+                                 thread_body_t body_b) {
+    for (int l = 0; l < howmany_loops; ++l) {
+        if (loops[l] == body_a || loops[l] == body_b)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Appends to the given list of threads num_threads copies of each packet loop,
+ * each one with its own copy of the configuration (hence its own queue or
+ * socket). The TSC loop is appended only once.
+ *
+ * \return the new number of threads in the list.
+ * */
+static inline int threads_append(thread_body_t threads_loop[],
+                                 void *threads_arg[], int howmany_threads,
+                                 const thread_body_t loops[],
+                                 const int howmany_loops,
+                                 struct config threads_conf[],
+                                 const struct config *conf) {
+    for (unsigned int t = 0; t < conf->num_threads; ++t) {
+        threads_conf[t] = *conf;
+        threads_conf[t].thread_id = t;
+
+        if (config_initialize_thread_socket(&threads_conf[t]))
+            perror_exit("ERR: Could not initialize socket of thread %u.\n", t);
+    }
+
+    for (int l = 0; l < howmany_loops; ++l) {
+        if (loops[l] == tsc_loop) {
+            threads_loop[howmany_threads] = loops[l];
+            threads_arg[howmany_threads] = &threads_conf[0];
+            ++howmany_threads;
+            continue;
+        }
+
+        for (unsigned int t = 0; t < conf->num_threads; ++t) {
+            threads_loop[howmany_threads] = loops[l];
+            threads_arg[howmany_threads] = &threads_conf[t];
+            ++howmany_threads;
+        }
+    }
+
+    return howmany_threads;
+}
+
+/**
+ * Runs the given loops, each one on num_threads threads. If any peer loop is
+ * given, the command is a DPDK loopback test: peer loops run in the same
+ * process as the other side of the test, see dpdk_init.
+ * */
 static inline int command_body(int argc, char *argv[],
                                const struct config_defaults *defaults,
                                const thread_body_t loops[],
-                               const int howmany_loops) {
+                               const int howmany_loops,
+                               const thread_body_t peer_loops[],
+                               const int howmany_peer_loops) {
     struct config conf;
+    struct config peer_conf;
 
     config_initialize(&conf, defaults);
 
@@ -105,6 +183,31 @@ static inline int command_body(int argc, char *argv[],
     if (res <= 0)
         perror_exit("ERR: Could not parse arguments correctly!");
 
+    if (howmany_peer_loops > 0) {
+        if (!USE_DPDK(&conf))
+            perror_exit("ERR: Loopback tests are supported by DPDK only.\n");
+        conf.dpdk.loopback = true;
+    }
+
+    if (conf.capture.path != NULL &&
+        !loops_include(loops, howmany_loops, recv_loop, server_loop) &&
+        !loops_include(peer_loops, howmany_peer_loops, recv_loop, server_loop))
+        perror_exit("ERR: Capture is supported by recv and server only.\n");
+
+    if (conf.replay.path != NULL &&
+        !loops_include(loops, howmany_loops, send_loop, client_loop))
+        perror_exit("ERR: Replay is supported by send and client only.\n");
+
+    if (conf.search.ctrl != NULL &&
+        (howmany_peer_loops > 0 ||
+         loops_include(loops, howmany_loops, client_loop, server_loop) ||
+         !loops_include(loops, howmany_loops, send_loop, recv_loop)))
+        perror_exit("ERR: Rate search is supported by send and recv only.\n");
+
+    if (conf.search.max_delay_us != 0 &&
+        !loops_include(loops, howmany_loops, client_loop, client_loop))
+        perror_exit("ERR: Latency search is supported by client only.\n");
+
     config_print(&conf);
 
     // Shift arguments, certain NFV sockets may require additional arguments
@@ -122,19 +225,77 @@ static inline int command_body(int argc, char *argv[],
     // Initialize the Time Stamp Counter handle for loop usage
     tsc_init();
 
+    // Captured packets are timestamped using the TSC
+    res = capture_init(&conf);
+    if (res)
+        return EXIT_FAILURE;
+
+    // Replayed packets are paced using the TSC too
+    res = replay_init(&conf);
+    if (res)
+        return EXIT_FAILURE;
+
+    // Timing traces are converted to TSC cycles once for all threads
+    res = pacer_trace_init(&conf);
+    if (res)
+        return EXIT_FAILURE;
+
+    // The sending (or client) side drives the search, the receiving one
+    // answers
+    res = search_init(
+        &conf, loops_include(loops, howmany_loops, send_loop, send_loop),
+        loops_include(loops, howmany_loops, client_loop, client_loop));
+    if (res)
+        return EXIT_FAILURE;
+
     // Initialize cores management, works only after initialization of both
     // configuration and sockets
     cores_init(&conf);
 
+    // Each packet loop is run by num_threads threads, the peer ones (if any)
+    // with a mirrored configuration; the capture and search loops (if any) by
+    // one thread each
+    const int max_threads = (howmany_loops + howmany_peer_loops) *
+                                conf.num_threads +
+                            2;
+    struct config threads_conf[conf.num_threads];
+    struct config peer_threads_conf[conf.num_threads];
+    thread_body_t threads_loop[max_threads];
+    void *threads_arg[max_threads];
+    int howmany_threads;
+
+    howmany_threads = threads_append(threads_loop, threads_arg, 0, loops,
+                                     howmany_loops, threads_conf, &conf);
+
+    if (howmany_peer_loops > 0) {
+        config_peer(&peer_conf, &conf);
+        howmany_threads = threads_append(
+            threads_loop, threads_arg, howmany_threads, peer_loops,
+            howmany_peer_loops, peer_threads_conf, &peer_conf);
+    }
+
+    if (conf.capture.capture != NULL) {
+        threads_loop[howmany_threads] = capture_loop;
+        threads_arg[howmany_threads] = &conf;
+        ++howmany_threads;
+    }
+
+    if (conf.search.search != NULL) {
+        threads_loop[howmany_threads] = search_loop;
+        threads_arg[howmany_threads] = &conf;
+        ++howmany_threads;
+    }
+
     // Check that the user started the application with the right number of
     // cores
-    core_t num_cores = check_cores(&conf, (const core_t *const) &howmany_loops);
+    core_t num_cores =
+        check_cores(&conf, (const core_t *const) &howmany_threads);
 
     // Prepare the data for each worker. NOTICE: the last worker shall be
     // executed on the master core by setting this thread affinity to the
     // master core and running the function
 
-    struct thread_info workers_info[howmany_loops];
+    struct thread_info workers_info[howmany_threads];
 
     core_t i = 0;
     core_t core_id;
@@ -146,13 +307,14 @@ static inline int command_body(int argc, char *argv[],
         if (i >= num_cores - 1)
             break;
 
-        workers_info[i] = (struct thread_info){core_id, loops[i], 0, &conf};
+        workers_info[i] = (struct thread_info){core_id, threads_loop[i], 0,
+                                               threads_arg[i]};
         ++i;
     }
 
     // This last loop will run on the master core
-    workers_info[i] =
-        (struct thread_info){cores_get_master(&conf), loops[i], 0, &conf};
+    workers_info[i] = (struct thread_info){cores_get_master(&conf),
+                                           threads_loop[i], 0, threads_arg[i]};
 
     printf("-------------------------------------\n");
     printf("STARTING WORKER THREADS...\n");
@@ -163,7 +325,7 @@ static inline int command_body(int argc, char *argv[],
         if (res)
             perror_exit(
                 "ERR: failed to start worker thread %d/%d.\nCause: %s\n", i,
-                howmany_loops, strerror(errno));
+                howmany_threads, strerror(errno));
     }
 
     printf("\n");
@@ -191,19 +353,22 @@ static inline int command_body(int argc, char *argv[],
 int recv_body(int argc, char *argv[]) {
     thread_body_t loops[] = {recv_loop};
     int howmany_loops = sizeof(loops) / sizeof(thread_body_t);
-    return command_body(argc, argv, &defaults_recv, loops, howmany_loops);
+    return command_body(argc, argv, &defaults_recv, loops, howmany_loops,
+                        NULL, 0);
 }
 
 int send_body(int argc, char *argv[]) {
     thread_body_t loops[] = {send_loop};
     int howmany_loops = sizeof(loops) / sizeof(thread_body_t);
-    return command_body(argc, argv, &defaults_send, loops, howmany_loops);
+    return command_body(argc, argv, &defaults_send, loops, howmany_loops,
+                        NULL, 0);
 }
 
 int server_body(int argc, char *argv[]) {
     thread_body_t loops[] = {server_loop};
     int howmany_loops = sizeof(loops) / sizeof(thread_body_t);
-    return command_body(argc, argv, &defaults_server, loops, howmany_loops);
+    return command_body(argc, argv, &defaults_server, loops, howmany_loops,
+                        NULL, 0);
 }
 
 int client_body(int argc, char *argv[]) {
@@ -213,11 +378,35 @@ int client_body(int argc, char *argv[]) {
         send_loop,
     };
     int howmany_loops = sizeof(loops) / sizeof(thread_body_t);
-    return command_body(argc, argv, &defaults_client, loops, howmany_loops);
+    return command_body(argc, argv, &defaults_client, loops, howmany_loops,
+                        NULL, 0);
 }
 
 int clientst_body(int argc, char *argv[]) {
     thread_body_t loops[] = {client_loop};
     int howmany_loops = sizeof(loops) / sizeof(thread_body_t);
-    return command_body(argc, argv, &defaults_client, loops, howmany_loops);
+    return command_body(argc, argv, &defaults_client, loops, howmany_loops,
+                        NULL, 0);
+}
+
+int loopback_body(int argc, char *argv[]) {
+    thread_body_t loops[] = {send_loop};
+    thread_body_t peer_loops[] = {recv_loop};
+    int howmany_loops = sizeof(loops) / sizeof(thread_body_t);
+    int howmany_peer_loops = sizeof(peer_loops) / sizeof(thread_body_t);
+    return command_body(argc, argv, &defaults_send, loops, howmany_loops,
+                        peer_loops, howmany_peer_loops);
+}
+
+int loopback_client_body(int argc, char *argv[]) {
+    thread_body_t loops[] = {
+        tsc_loop,
+        client_loop,
+        send_loop,
+    };
+    thread_body_t peer_loops[] = {server_loop};
+    int howmany_loops = sizeof(loops) / sizeof(thread_body_t);
+    int howmany_peer_loops = sizeof(peer_loops) / sizeof(thread_body_t);
+    return command_body(argc, argv, &defaults_client, loops, howmany_loops,
+                        peer_loops, howmany_peer_loops);
 }
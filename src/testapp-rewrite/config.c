@@ -10,16 +10,23 @@
 #include <unistd.h>
 
 #include <fcntl.h>
+#include <linux/filter.h>
 #include <linux/if_ether.h>
 
 #include <arpa/inet.h>
 #include <net/if.h>
 #include <netinet/in.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 
 #include "config.h"
 #include "constants.h"
 #include "dpdk.h"
+#include "hdr_tools.h"
+#include "pacer.h"
+#include "packet_ring.h"
+#include "shm.h"
+#include "xdp.h"
 
 /* ------------------------------- Constants -------------------------------- */
 
@@ -34,8 +41,16 @@ static const struct config CONFIG_STRUCT_INITIALIZER = {
     .payload_size = PKT_SIZE_TO_PAYLOAD(DEFAULT_PKT_SIZE),
     .bst_size = DEFAULT_BST_SIZE,
 
+    .num_threads = DEFAULT_THREADS,
+    .thread_id = 0,
+    .is_peer = false,
+
     .use_block = false,
     .use_mmsg = false,
+    .use_ring = false,
+    .use_gso = false,
+    .use_zerocopy = false,
+    .use_cpu_steering = false,
 
     .silent = false,
     .touch_data = false,
@@ -45,12 +60,68 @@ static const struct config CONFIG_STRUCT_INITIALIZER = {
 
     .sock_type = NFV_SOCK_NONE,
     .sock_fd = -1,
+    .raw_ring = NULL,
 
     .dpdk =
         {
             .portid = 0,
+            .loopback = false,
+            .peer_portid = 0,
+            .use_flows = false,
+            .flow_filtered = false,
+            .static_payloads = false,
+            .tx_chained = false,
+            .gso_size = 0,
             .direction = DIRECTION_TXRX,
             .mbufs = NULL,
+            .tx_pools = {{NULL, NULL, NULL, NULL}},
+        },
+
+    .xdp =
+        {
+            .queue_id = 0,
+            .xsk = NULL,
+        },
+
+    .shm =
+        {
+            .path = NULL,
+            .chan = NULL,
+        },
+
+    .capture =
+        {
+            .path = NULL,
+            .sampling = 1,
+            .capture = NULL,
+        },
+
+    .replay =
+        {
+            .path = NULL,
+            .timing = false,
+            .replay = NULL,
+        },
+
+    .pacer =
+        {
+            .catchup = PACER_CATCHUP_BURST,
+            .spacing = false,
+            .profile = PACER_PROFILE_CBR,
+            .on_us = 0,
+            .off_us = 0,
+            .trace_path = NULL,
+            .trace = NULL,
+        },
+
+    .search =
+        {
+            .ctrl = NULL,
+            .max_loss = 0,
+            .trial_ms = 1000,
+            .max_delay_us = 0,
+            .percentile = 99,
+            .search = NULL,
         },
 };
 
@@ -74,6 +145,20 @@ const char usage_format_string[] =
     "    -p <packet_size=64>    The size of each frame in bytes.\n"
     "    -b <burst_size=32>     The size of each packet burst in number of "
     "packets.\n"
+    "    -t <threads=1>         The number of threads running each packet "
+    "loop.\n"
+    "                           Each thread uses its own device queue, "
+    "incoming packets are spread\n"
+    "                           among queues using RSS on the UDP 5-tuple.\n"
+    "                           Valid only for DPDK programs, UDP, raw and "
+    "null sockets.\n"
+    "                           With UDP sockets, each thread opens its own "
+    "socket (SO_REUSEPORT):\n"
+    "                           sending threads use different local ports, "
+    "receiving ones share it.\n"
+    "                           With raw sockets, each thread opens its own "
+    "socket, all of them\n"
+    "                           in the same PACKET_FANOUT group.\n"
     "\n"
     "    -c                     Generate actual data/Calculate a checksum on "
     "each received payload.\n"
@@ -87,6 +172,39 @@ const char usage_format_string[] =
     "                           Valid only for sockets-based programs, not "
     "DPDK ones.\n"
     "\n"
+    "    -X <interf_name>[:<queue>]\n"
+    "                           Use AF_XDP sockets instead of UDP ones.\n"
+    "                           The argument is the name of the interface to "
+    "use,\n"
+    "                           optionally followed by the queue to bind to "
+    "(default 0).\n"
+    "                           Zero-copy mode is used if supported by the "
+    "interface driver.\n"
+    "                           Valid only for sockets-based programs, not "
+    "DPDK ones.\n"
+    "\n"
+    "    -U                     Use UDP sockets driven through io_uring.\n"
+    "                           Valid only for sockets-based programs, not "
+    "DPDK ones.\n"
+    "\n"
+    "    -S <path>              Exchange packets through rings in a shared "
+    "memory file instead of sockets.\n"
+    "                           The argument is the path of the file, which "
+    "should be on a hugetlbfs mount\n"
+    "                           shared by both applications; it is created "
+    "if it does not exist.\n"
+    "                           Valid only for sockets-based programs, not "
+    "DPDK ones.\n"
+    "\n"
+    "    -N                     Use a null socket, which discards sent packets "
+    "and receives\n"
+    "                           always the same packets, without involving "
+    "the kernel.\n"
+    "                           Measures the packet rate sustainable by the "
+    "application itself.\n"
+    "                           Valid only for sockets-based programs, not "
+    "DPDK ones.\n"
+    "\n"
     "    -B                     Use blocking sockets instead of nonblocking "
     "ones.\n"
     "                           Valid only for sockets-based programs, not "
@@ -97,6 +215,123 @@ const char usage_format_string[] =
     "                           Valid only for sockets-based programs, not "
     "DPDK ones.\n"
     "\n"
+    "    -M                     Use PACKET_MMAP rings (TPACKET_V3) to exchange "
+    "packets.\n"
+    "                           Valid only for RAW sockets (see -R).\n"
+    "\n"
+    "    -G                     Use UDP segmentation and receive offloads "
+    "(UDP_SEGMENT/UDP_GRO)\n"
+    "                           to exchange each burst with few system calls.\n"
+    "                           Valid only for UDP sockets.\n"
+    "\n"
+    "    -Z                     Send packets without copying their payload "
+    "(MSG_ZEROCOPY).\n"
+    "                           Payloads are reused only after the kernel is "
+    "done with them.\n"
+    "                           Valid only for UDP sockets.\n"
+    "\n"
+    "    -C                     Steer each incoming packet to the thread with "
+    "index equal to the\n"
+    "                           receiving CPU modulo the number of threads "
+    "(reuseport BPF program\n"
+    "                           or PACKET_FANOUT_CPU), instead of hashing "
+    "its flow.\n"
+    "                           Valid only for UDP and raw sockets with "
+    "multiple threads (see -t).\n"
+    "\n"
+    "    -F                     Install flow rules (rte_flow) matching the "
+    "local MAC/IP/UDP port,\n"
+    "                           so that the device drops foreign packets and "
+    "steers flows to\n"
+    "                           queues. Falls back to software filtering if "
+    "not supported.\n"
+    "                           Valid only for DPDK-based programs.\n"
+    "\n"
+    "    -P                     Send the same set of prepared packets over "
+    "and over, without\n"
+    "                           writing payloads or timestamps (throughput "
+    "tests only).\n"
+    "                           Valid only for DPDK-based send programs.\n"
+    "\n"
+    "    -g <size>              Split each outgoing packet in IP fragments of "
+    "at most size bytes\n"
+    "                           in software (librte_gso), to send payloads "
+    "bigger than the MTU.\n"
+    "                           Valid only for DPDK-based programs.\n"
+    "\n"
+    "    -W <path>              Capture received packets to the given pcap "
+    "file. Packets are\n"
+    "                           copied to a ring and written by a thread on "
+    "a core of its own.\n"
+    "                           Valid only for programs receiving packets "
+    "(recv and server).\n"
+    "\n"
+    "    -w <n>                 Capture one received packet every n "
+    "(default 1, see -W).\n"
+    "\n"
+    "    -I <path>              Replay the payloads of the packets in the "
+    "given pcap file,\n"
+    "                           preloaded in memory, instead of synthetic "
+    "ones. Payloads are\n"
+    "                           truncated or padded to the packet size "
+    "(see -p), addresses and\n"
+    "                           ports are the configured ones.\n"
+    "                           Valid only for programs sending packets "
+    "(send and client).\n"
+    "\n"
+    "    -T                     Replay packets with the original timing of "
+    "the pcap file, instead\n"
+    "                           of the configured rate (see -I).\n"
+    "\n"
+    "    -L <policy=burst>      What sending loops do when they are late on "
+    "their schedule:\n"
+    "                           burst sends all late packets back-to-back, "
+    "cap sends at most\n"
+    "                           a few late bursts back-to-back, skip does "
+    "not send late packets.\n"
+    "\n"
+    "    -D                     Space the packets of each burst evenly at the "
+    "configured rate,\n"
+    "                           instead of sending the whole burst at once.\n"
+    "\n"
+    "    -O <profile=cbr>       How gaps between departures (bursts, or "
+    "packets with -D) are drawn:\n"
+    "                           cbr keeps them constant, poisson draws them "
+    "from an exponential\n"
+    "                           distribution, onoff:<on_us>:<off_us> "
+    "alternates phases of the given\n"
+    "                           durations sending only in on phases, "
+    "trace:<path> reads them from\n"
+    "                           a file (one gap in ns per line, the rate is "
+    "ignored).\n"
+    "                           The average rate is the configured one, except "
+    "for traces.\n"
+    "\n"
+    "    -Q <ip:port>           Search the highest rate (up to the one given "
+    "with -r) at which\n"
+    "                           packets are not lost, running trials at "
+    "different rates; the\n"
+    "                           receiver listens on the given address for "
+    "the sender to report\n"
+    "                           its counts of each trial.\n"
+    "                           Valid only for send and recv programs.\n"
+    "\n"
+    "    -A <loss=0>            The fraction of packets that may be lost in "
+    "a passing trial (see -Q).\n"
+    "\n"
+    "    -J <ms=1000>           The duration of each trial (see -Q and -K).\n"
+    "\n"
+    "    -K <us>                Search the highest rate (up to the one given "
+    "with -r) at which\n"
+    "                           the percentile given with -k of round-trip "
+    "delays does not\n"
+    "                           exceed the given target, running trials at "
+    "different rates.\n"
+    "                           Valid only for client programs.\n"
+    "\n"
+    "    -k <percentile=99>     The percentile of delays compared to the "
+    "target (see -K).\n"
+    "\n"
     "    -s                     Run in silent mode. Prints no stats until the "
     "termination SIGINT is received.\n"
     "\n"
@@ -117,6 +352,21 @@ const char usage_format_string[] =
     "       <LOCAL_IP> <LOCAL_MAC> <REMOTE_IP> <REMOTE_MAC> \n"
     "\n";
 
+/* Names of the catch-up policies, indexed by enum pacer_catchup */
+static const char *const catchup_names[] = {
+    [PACER_CATCHUP_BURST] = "burst",
+    [PACER_CATCHUP_CAP] = "cap",
+    [PACER_CATCHUP_SKIP] = "skip",
+};
+
+/* Names of the traffic profiles, indexed by enum pacer_profile */
+static const char *const profile_names[] = {
+    [PACER_PROFILE_CBR] = "cbr",
+    [PACER_PROFILE_POISSON] = "poisson",
+    [PACER_PROFILE_ONOFF] = "onoff",
+    [PACER_PROFILE_TRACE] = "trace",
+};
+
 /* --------------------------- Private Functions ---------------------------- */
 
 /**
@@ -133,6 +383,91 @@ static inline bool check_doubledash(char *s) { return strcmp(s, "--") == 0; }
  * */
 static inline bool check_dash(char *s) { return s[0] == '-'; }
 
+/**
+ * Parse the name of a catch-up policy of sending loops.
+ *
+ * \return 0 on success, -1 if the name is unknown.
+ * */
+static inline int catchup_parse(const char *s, enum pacer_catchup *catchup) {
+    const size_t n = sizeof(catchup_names) / sizeof(catchup_names[0]);
+
+    for (size_t i = 0; i < n; ++i) {
+        if (strcmp(s, catchup_names[i]) == 0) {
+            *catchup = i;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Parse a traffic profile of sending loops, i.e. its name optionally followed
+ * by a colon and its parameters.
+ *
+ * \return 0 on success, -1 if the name is unknown or parameters are wrong.
+ * */
+static inline int profile_parse(char *s, struct pacer_conf *pacer) {
+    const size_t n = sizeof(profile_names) / sizeof(profile_names[0]);
+    char *params = strchr(s, ':');
+    char *end;
+    size_t i;
+
+    if (params != NULL)
+        *params++ = '\0';
+
+    for (i = 0; i < n && strcmp(s, profile_names[i]) != 0; ++i)
+        ;
+
+    pacer->profile = i;
+
+    switch (i) {
+    case PACER_PROFILE_CBR:
+    case PACER_PROFILE_POISSON:
+        return params == NULL ? 0 : -1;
+    case PACER_PROFILE_ONOFF:
+        if (params == NULL)
+            return -1;
+        pacer->on_us = strtoul(params, &end, 10);
+        if (*end != ':')
+            return -1;
+        pacer->off_us = strtoul(end + 1, &end, 10);
+        return *end == '\0' ? 0 : -1;
+    case PACER_PROFILE_TRACE:
+        pacer->trace_path = params;
+        return (params == NULL || *params == '\0') ? -1 : 0;
+    default:
+        return -1;
+    }
+}
+
+/**
+ * Parse an AF_XDP interface, i.e. its name optionally followed by a colon and
+ * the index of the interface queue the socket shall be bound to (default 0).
+ *
+ * \return 0 on success, -1 if the queue index is wrong.
+ * */
+static inline int xdp_interf_parse(char *s, struct config *conf) {
+    const size_t buflen = sizeof(conf->local_interf);
+    char *queue = strrchr(s, ':');
+    char *end;
+    unsigned long queue_id = 0;
+
+    if (queue != NULL) {
+        *queue++ = '\0';
+        queue_id = strtoul(queue, &end, 10);
+        if (*queue == '\0' || *end != '\0' || queue_id > UINT32_MAX)
+            return -1;
+    }
+
+    conf->xdp.queue_id = queue_id;
+
+    strncpy(conf->local_interf, s, buflen - 1);
+    conf->local_interf[buflen - 1] = '\0';
+
+    return 0;
+}
+
 /**
  * Parse option arguments.
  *
@@ -164,7 +499,9 @@ static inline int options_parse(int argc, char *argv[], struct config *conf,
     const size_t buflen = sizeof(conf->local_interf);
     assert(buflen > 0);
 
-    while ((opt = getopt(argc, argv, "+r:p:b:R:cmsB")) != -1) {
+    while ((opt = getopt(argc, argv,
+                         "+r:p:b:t:R:X:S:W:w:I:g:L:O:Q:A:J:K:k:"
+                         "cmMsBUGZNCFTPD")) != -1) {
         switch (opt) {
         case 'r':
             conf->rate = atoi(optarg);
@@ -176,9 +513,12 @@ static inline int options_parse(int argc, char *argv[], struct config *conf,
         case 'b':
             conf->bst_size = atoi(optarg);
             break;
+        case 't':
+            conf->num_threads = atoi(optarg);
+            break;
         case 'R':
             /* NOTICE: option is ignored by non-Linux based configurations */
-            if ((conf->sock_type & (NFV_SOCK_DGRAM | NFV_SOCK_RAW)) == 0)
+            if ((conf->sock_type & NFV_SOCK_LINUX) == 0)
                 continue;
 
             conf->sock_type = NFV_SOCK_RAW;
@@ -186,6 +526,41 @@ static inline int options_parse(int argc, char *argv[], struct config *conf,
             strncpy(conf->local_interf, optarg, buflen - 1);
             conf->local_interf[buflen - 1] = '\0';
 
+            break;
+        case 'X':
+            /* NOTICE: option is ignored by non-Linux based configurations */
+            if ((conf->sock_type & NFV_SOCK_LINUX) == 0)
+                continue;
+
+            conf->sock_type = NFV_SOCK_XDP;
+
+            if (xdp_interf_parse(optarg, conf)) {
+                fprintf(stderr, usage_format_string, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+
+            break;
+        case 'U':
+            /* NOTICE: option is ignored by non-Linux based configurations */
+            if ((conf->sock_type & NFV_SOCK_LINUX) == 0)
+                continue;
+
+            conf->sock_type = NFV_SOCK_URING;
+            break;
+        case 'N':
+            /* NOTICE: option is ignored by non-Linux based configurations */
+            if ((conf->sock_type & NFV_SOCK_LINUX) == 0)
+                continue;
+
+            conf->sock_type = NFV_SOCK_NULL;
+            break;
+        case 'S':
+            /* NOTICE: option is ignored by non-Linux based configurations */
+            if ((conf->sock_type & NFV_SOCK_LINUX) == 0)
+                continue;
+
+            conf->sock_type = NFV_SOCK_SHM;
+            conf->shm.path = optarg;
             break;
         case 'B':
             conf->use_block = true;
@@ -196,6 +571,69 @@ static inline int options_parse(int argc, char *argv[], struct config *conf,
         case 'm':
             conf->use_mmsg = true;
             break;
+        case 'M':
+            conf->use_ring = true;
+            break;
+        case 'G':
+            conf->use_gso = true;
+            break;
+        case 'Z':
+            conf->use_zerocopy = true;
+            break;
+        case 'C':
+            conf->use_cpu_steering = true;
+            break;
+        case 'F':
+            conf->dpdk.use_flows = true;
+            break;
+        case 'P':
+            conf->dpdk.static_payloads = true;
+            break;
+        case 'g':
+            conf->dpdk.gso_size = atoi(optarg);
+            break;
+        case 'W':
+            conf->capture.path = optarg;
+            break;
+        case 'w':
+            conf->capture.sampling = atoi(optarg);
+            break;
+        case 'I':
+            conf->replay.path = optarg;
+            break;
+        case 'T':
+            conf->replay.timing = true;
+            break;
+        case 'L':
+            if (catchup_parse(optarg, &conf->pacer.catchup)) {
+                fprintf(stderr, usage_format_string, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'D':
+            conf->pacer.spacing = true;
+            break;
+        case 'O':
+            if (profile_parse(optarg, &conf->pacer)) {
+                fprintf(stderr, usage_format_string, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'Q':
+            conf->search.ctrl = optarg;
+            break;
+        case 'A':
+            conf->search.max_loss = atof(optarg);
+            break;
+        case 'J':
+            conf->search.trial_ms = atoi(optarg);
+            break;
+        case 'K':
+            conf->search.max_delay_us = atof(optarg);
+            break;
+        case 'k':
+            conf->search.percentile = atof(optarg);
+            break;
         case 's':
             conf->silent = true;
             break;
@@ -388,9 +826,26 @@ static inline int args_parse(int argc, char *argv[], struct config *conf,
     return argind;
 }
 
+/**
+ * Tells whether the sockets of all threads shall be bound to the same local
+ * port, which is the case for commands receiving flows from many remote
+ * threads (recv and server). Threads of the other commands originate their own
+ * flows, each one from a different port.
+ * */
+static inline bool sock_shares_port(struct config *conf) {
+    return strstr(conf->cmdname, "recv") != NULL ||
+           strstr(conf->cmdname, "server") != NULL;
+}
+
 /**
  * Open an UDP socket descriptor.
  *
+ * When multiple threads are used, each one has its own socket with
+ * SO_REUSEPORT set, bound either to the local port shared by all threads or
+ * to local port + thread_id (see sock_shares_port). Sockets sharing the port
+ * are not connected, since they receive from many remote threads; replies are
+ * sent to the source of each packet anyway (see nfv_socket_simple).
+ *
  * \param sock_fd will be filled with the actual file descriptor of the opened
  * socket.
  *
@@ -403,6 +858,10 @@ static inline int args_parse(int argc, char *argv[], struct config *conf,
  * \return 0 on success, non-zero otherwise.
  * */
 static inline int sock_create_dgram(struct config *conf, uint32_t flags) {
+    struct sockaddr_in local_addr = conf->local.ip;
+    bool multi = conf->num_threads > 1;
+    bool shared_port = multi && sock_shares_port(conf);
+    int one = 1;
     int res;
 
     res = socket(AF_INET, SOCK_DGRAM, 0);
@@ -413,8 +872,22 @@ static inline int sock_create_dgram(struct config *conf, uint32_t flags) {
 
     conf->sock_fd = res;
 
-    res = bind(conf->sock_fd, (const struct sockaddr *)&conf->local.ip,
-               sizeof(conf->local.ip));
+    if (multi) {
+        res = setsockopt(conf->sock_fd, SOL_SOCKET, SO_REUSEPORT, &one,
+                         sizeof(one));
+        if (res < 0) {
+            perror("Could not set SO_REUSEPORT");
+            close(conf->sock_fd);
+            return res;
+        }
+
+        if (!shared_port)
+            local_addr.sin_port =
+                htons(ntohs(local_addr.sin_port) + conf->thread_id);
+    }
+
+    res = bind(conf->sock_fd, (const struct sockaddr *)&local_addr,
+               sizeof(local_addr));
     if (res < 0) {
         perror("Could not bind to local ip/port");
         close(conf->sock_fd);
@@ -422,12 +895,14 @@ static inline int sock_create_dgram(struct config *conf, uint32_t flags) {
     }
 
     // FIXME: Must use connected sockets for outgoing packets!
-    res = connect(conf->sock_fd, (struct sockaddr *)&conf->remote.ip,
-                  sizeof(conf->remote.ip));
-    if (res < 0) {
-        perror("Could not connect to remote ip/port");
-        close(conf->sock_fd);
-        return res;
+    if (!shared_port) {
+        res = connect(conf->sock_fd, (struct sockaddr *)&conf->remote.ip,
+                      sizeof(conf->remote.ip));
+        if (res < 0) {
+            perror("Could not connect to remote ip/port");
+            close(conf->sock_fd);
+            return res;
+        }
     }
 
     // If the socket should be non blocking, set it so, otherwise remove the
@@ -453,21 +928,313 @@ static inline int sock_create_dgram(struct config *conf, uint32_t flags) {
 }
 
 /**
- * Open a raw socket descriptor.
+ * Attaches to the reuseport group of the given socket a program that selects,
+ * for each incoming packet, the socket of index equal to the receiving CPU
+ * modulo the number of threads. Sockets are indexed in order of binding, that
+ * is by thread_id. With RSS and interrupts spread on the cores of the
+ * application, each flow is then consumed where it is received.
  *
- * \param sock_fd will be filled with the actual file descriptor of the opened
- * socket.
+ * \return 0 on success, non-zero otherwise.
+ * */
+static inline int sock_setup_steering(struct config *conf) {
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_CPU),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, conf->num_threads),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+    struct sock_fprog prog = {
+        .len = sizeof(code) / sizeof(code[0]),
+        .filter = code,
+    };
+    int res;
+
+    res = setsockopt(conf->sock_fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                     &prog, sizeof(prog));
+    if (res < 0) {
+        perror("Could not attach reuseport steering program");
+        close(conf->sock_fd);
+        return res;
+    }
+
+    return 0;
+}
+
+/**
+ * Enables UDP segmentation offload with segments of exactly one payload, so
+ * that a single send produces many datagrams, and UDP receive offload, so
+ * that many datagrams of the same flow can be received at once.
  *
- * \param ifname the name of the interface to be used with the new raw
- * socket.
+ * \return 0 on success, non-zero otherwise.
+ * */
+static inline int sock_setup_gso(struct config *conf) {
+    int gso_size = conf->payload_size;
+    int one = 1;
+    int res;
+
+    res = setsockopt(conf->sock_fd, SOL_UDP, UDP_SEGMENT, &gso_size,
+                     sizeof(gso_size));
+    if (res < 0) {
+        perror("Could not enable UDP segmentation offload");
+        close(conf->sock_fd);
+        return res;
+    }
+
+    res = setsockopt(conf->sock_fd, SOL_UDP, UDP_GRO, &one, sizeof(one));
+    if (res < 0) {
+        perror("Could not enable UDP receive offload");
+        close(conf->sock_fd);
+        return res;
+    }
+
+    return 0;
+}
+
+/**
+ * Enables MSG_ZEROCOPY transmissions on the given socket. Each send using it
+ * is later notified on the socket error queue, see nfv_socket_simple.
+ *
+ * \return 0 on success, non-zero otherwise.
+ * */
+static inline int sock_setup_zerocopy(struct config *conf) {
+    int one = 1;
+    int res;
+
+    res = setsockopt(conf->sock_fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one));
+    if (res < 0) {
+        perror("Could not enable zerocopy transmissions");
+        close(conf->sock_fd);
+        return res;
+    }
+
+    return 0;
+}
+
+/**
+ * Open an UDP socket descriptor and set it up as requested by the
+ * configuration.
+ *
+ * \return 0 on success, non-zero otherwise.
+ * */
+static inline int sock_init_dgram(struct config *conf) {
+    int res;
+
+    // Need additional flags?
+    res = sock_create_dgram(conf, 0);
+    if (res == 0 && conf->use_gso)
+        res = sock_setup_gso(conf);
+    if (res == 0 && conf->use_zerocopy)
+        res = sock_setup_zerocopy(conf);
+
+    // The program is shared by the whole group, the first socket is enough
+    if (res == 0 && conf->use_cpu_steering && conf->num_threads > 1 &&
+        conf->thread_id == 0 && sock_shares_port(conf))
+        res = sock_setup_steering(conf);
+
+    return res;
+}
+
+/**
+ * Set up PACKET_MMAP rings on the given raw socket.
+ *
+ * The RX ring uses TPACKET_V3 block-based reception, so that the kernel can
+ * hand many packets to the application at once; the TX ring is frame-based
+ * and flushed with one system call per burst. Outgoing packets also bypass
+ * the queueing discipline layer.
+ *
+ * \param conf the configuration, whose sock_fd is already open; on success
+ * its raw_ring field points to the mapped rings.
+ *
+ * \return 0 on success, non-zero otherwise.
+ * */
+static inline int sock_setup_ring(struct config *conf) {
+    struct packet_ring *ring;
+    int version = TPACKET_V3;
+    int one = 1;
+    int res;
+
+    res = setsockopt(conf->sock_fd, SOL_PACKET, PACKET_VERSION, &version,
+                     sizeof(version));
+    if (res < 0) {
+        perror("ERR: could not set TPACKET_V3");
+        return res;
+    }
+
+    ring = calloc(1, sizeof(struct packet_ring));
+    if (ring == NULL) {
+        perror("ERR: could not allocate packet ring");
+        return -1;
+    }
+
+    ring->rx_req.tp_block_size = PACKET_RING_BLOCK_SIZE;
+    ring->rx_req.tp_block_nr = PACKET_RING_RX_BLOCKS;
+    ring->rx_req.tp_frame_size = PACKET_RING_FRAME_SIZE;
+    ring->rx_req.tp_frame_nr = PACKET_RING_BLOCK_SIZE /
+                               PACKET_RING_FRAME_SIZE * PACKET_RING_RX_BLOCKS;
+    ring->rx_req.tp_retire_blk_tov = PACKET_RING_RX_TIMEOUT;
+
+    res = setsockopt(conf->sock_fd, SOL_PACKET, PACKET_RX_RING, &ring->rx_req,
+                     sizeof(ring->rx_req));
+    if (res < 0) {
+        perror("ERR: could not set up PACKET_RX_RING");
+        goto error;
+    }
+
+    ring->tx_req.tp_block_size = PACKET_RING_BLOCK_SIZE;
+    ring->tx_req.tp_block_nr = PACKET_RING_TX_BLOCKS;
+    ring->tx_req.tp_frame_size = PACKET_RING_FRAME_SIZE;
+    ring->tx_req.tp_frame_nr = PACKET_RING_BLOCK_SIZE /
+                               PACKET_RING_FRAME_SIZE * PACKET_RING_TX_BLOCKS;
+
+    res = setsockopt(conf->sock_fd, SOL_PACKET, PACKET_TX_RING, &ring->tx_req,
+                     sizeof(ring->tx_req));
+    if (res < 0) {
+        perror("ERR: could not set up PACKET_TX_RING");
+        goto error;
+    }
+
+    res = setsockopt(conf->sock_fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one,
+                     sizeof(one));
+    if (res < 0) {
+        // Not fatal, packets will simply go through the qdisc layer
+        perror("WARN: could not set PACKET_QDISC_BYPASS");
+    }
+
+    /* Both rings are mapped with a single mmap, RX ring first */
+    ring->map_size = (size_t)PACKET_RING_BLOCK_SIZE *
+                     (PACKET_RING_RX_BLOCKS + PACKET_RING_TX_BLOCKS);
+    ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, conf->sock_fd, 0);
+    if (ring->map == MAP_FAILED) {
+        perror("ERR: could not map packet rings");
+        res = -1;
+        goto error;
+    }
+
+    ring->rx_area = ring->map;
+    ring->tx_area =
+        ring->map + (size_t)PACKET_RING_BLOCK_SIZE * PACKET_RING_RX_BLOCKS;
+
+    conf->raw_ring = ring;
+
+    return 0;
+
+error:
+    // Rings set up on the socket are released when it is closed
+    free(ring);
+    return res;
+}
+
+/**
+ * Unmap the PACKET_MMAP rings set up by sock_setup_ring, if any, before the
+ * socket they are mapped on is closed.
+ * */
+static inline void sock_release_ring(struct config *conf) {
+    if (conf->raw_ring == NULL)
+        return;
+
+    munmap(conf->raw_ring->map, conf->raw_ring->map_size);
+    free(conf->raw_ring);
+    conf->raw_ring = NULL;
+}
+
+/**
+ * Attaches to the given raw socket a classic BPF program that accepts only
+ * the packets that hdr_check_incoming_ports would accept, so that the kernel
+ * drops frames meant for other applications before copying them to user
+ * space. The expected values are taken from the same incoming header used by
+ * the socket objects, any of the num_threads destination UDP ports starting
+ * from the local one is accepted.
+ *
+ * \return 0 on success, non-zero otherwise.
+ * */
+static inline int sock_setup_filter(struct config *conf) {
+    struct pkt_hdr hdr;
+    uint32_t mac_hi;
+    uint16_t mac_lo;
+    int res;
+
+    pkt_hdr_setup(&hdr, conf, DIR_INCOMING);
+
+    memcpy(&mac_hi, &hdr.ether.d_addr.addr_bytes[0], sizeof(mac_hi));
+    memcpy(&mac_lo, &hdr.ether.d_addr.addr_bytes[4], sizeof(mac_lo));
+
+    // Offsets assume the fixed-size headers used by the application, as
+    // hdr_check_incoming_ports does; BPF loads are in network byte order
+    struct sock_filter code[] = {
+        // Destination MAC address
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(mac_hi), 0, 12),
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 4),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohs(mac_lo), 0, 10),
+        // IPv4 carrying UDP
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, RTE_ETHER_TYPE_IPV4, 0, 8),
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 6),
+        // Destination IP address
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 30),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(hdr.ip.dst_addr), 0, 4),
+        // Destination UDP port, ports below the first one wrap around
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 36),
+        BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, ntohs(hdr.udp.dst_port)),
+        BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, conf->num_threads, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    struct sock_fprog prog = {
+        .len = sizeof(code) / sizeof(code[0]),
+        .filter = code,
+    };
+
+    res = setsockopt(conf->sock_fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog,
+                     sizeof(prog));
+    if (res < 0) {
+        perror("ERR: could not attach socket filter");
+        return res;
+    }
+
+    return 0;
+}
+
+/**
+ * Joins the given raw socket to the PACKET_FANOUT group of the application,
+ * so that incoming packets are spread among the sockets of all threads. Each
+ * flow is consumed by a single thread, chosen by hashing the flow or, if CPU
+ * steering is requested, by the CPU that received it.
+ *
+ * \return 0 on success, non-zero otherwise.
+ * */
+static inline int sock_setup_fanout(struct config *conf) {
+    int mode = conf->use_cpu_steering ? PACKET_FANOUT_CPU : PACKET_FANOUT_HASH;
+    int fanout = (getpid() & 0xFFFF) | (mode << 16);
+    int res;
+
+    res = setsockopt(conf->sock_fd, SOL_PACKET, PACKET_FANOUT, &fanout,
+                     sizeof(fanout));
+    if (res < 0) {
+        perror("ERR: could not join PACKET_FANOUT group");
+        close(conf->sock_fd);
+        return res;
+    }
+
+    return 0;
+}
+
+/**
+ * Open a raw socket descriptor.
+ *
+ * \param conf the configuration, sock_fd will be filled with the actual file
+ * descriptor of the opened socket and local_interf is the name of the
+ * interface to be used with the new raw socket. If use_ring is set,
+ * PACKET_MMAP rings are set up on the new socket too. Only packets directed
+ * to the application pass the kernel filter attached to the socket.
  *
  * \param flags used to set options on the new socket, optional, see
  * fcntl.
  *
  * \return 0 on success, non-zero otherwise.
  * */
-static inline int sock_create_raw(int *sock_fd, const char *ifname,
-                                  uint32_t flags) {
+static inline int sock_create_raw(struct config *conf, uint32_t flags) {
     int res;
 
     struct sockaddr_ll ll; /* Link-layer socket address descriptor */
@@ -475,14 +1242,29 @@ static inline int sock_create_raw(int *sock_fd, const char *ifname,
     /* Initialize structures */
     memset(&ll, 0, sizeof(struct sockaddr_ll));
 
-    /* Open a raw socket */
-    res = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    /* Open a raw socket, which receives nothing until bound to a protocol;
+     * this way no packet is queued before the filter is in place */
+    res = socket(AF_PACKET, SOCK_RAW, 0);
     if (res < 0) {
         perror("ERR: socket failed");
         return -1;
     }
 
-    *sock_fd = res;
+    conf->sock_fd = res;
+
+    res = sock_setup_filter(conf);
+    if (res) {
+        close(conf->sock_fd);
+        return -4;
+    }
+
+    if (conf->use_ring) {
+        res = sock_setup_ring(conf);
+        if (res) {
+            close(conf->sock_fd);
+            return -2;
+        }
+    }
 
     /* Set bind options for the given socket. To be more precise, we bind to any
      * possible address/protocol that can be used on the given interface
@@ -490,22 +1272,25 @@ static inline int sock_create_raw(int *sock_fd, const char *ifname,
     memset(&ll, 0, sizeof(ll));
     ll.sll_family = AF_PACKET;
     ll.sll_protocol = htons(ETH_P_ALL);
-    ll.sll_ifindex = if_nametoindex(ifname);
+    ll.sll_ifindex = if_nametoindex(conf->local_interf);
 
-    res = bind(*sock_fd, (struct sockaddr *)&ll, sizeof(struct sockaddr_ll));
+    res = bind(conf->sock_fd, (struct sockaddr *)&ll,
+               sizeof(struct sockaddr_ll));
     if (res < 0) {
         perror("ERR: failed to bind with interface");
-        close(*sock_fd);
+        sock_release_ring(conf);
+        close(conf->sock_fd);
         return -3;
     }
 
     if (flags) {
-        int oldflags = fcntl(*sock_fd, F_GETFL, 0);
-        res = fcntl(*sock_fd, F_SETFL, oldflags | flags);
+        int oldflags = fcntl(conf->sock_fd, F_GETFL, 0);
+        res = fcntl(conf->sock_fd, F_SETFL, oldflags | flags);
 
         if (res < 0) {
             perror("Could not set file descriptor flags");
-            close(*sock_fd);
+            sock_release_ring(conf);
+            close(conf->sock_fd);
 
             return res;
         }
@@ -581,6 +1366,133 @@ int config_parse_arguments(struct config *conf, int argc, char *argv[]) {
         argind = args_parse(argc, argv, conf, argind);
     }
 
+    if (conf->num_threads < 1 || conf->num_threads > MAX_THREADS) {
+        fprintf(stderr, "Number of threads must be between 1 and %d\n",
+                MAX_THREADS);
+        exit(EXIT_FAILURE);
+    }
+
+    // Each sending thread uses local port + thread_id, which must not wrap
+    // around onto unrelated (possibly privileged) ports
+    if (!sock_shares_port(conf) &&
+        ntohs(conf->local.ip.sin_port) + conf->num_threads - 1 > UINT16_MAX) {
+        fprintf(stderr, "Local port + number of threads - 1 must not exceed "
+                        "%u\n",
+                UINT16_MAX);
+        exit(EXIT_FAILURE);
+    }
+
+    // Other sockets share a single descriptor/ring among all threads
+    if (conf->num_threads > 1 &&
+        (conf->sock_type &
+         (NFV_SOCK_DPDK | NFV_SOCK_SIMPLE | NFV_SOCK_NULL)) == 0) {
+        fprintf(stderr, "Multiple threads are supported by DPDK, UDP, raw "
+                        "and null sockets only\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Segments of a burst would have to be split among their many senders
+    if (conf->num_threads > 1 && conf->use_gso &&
+        strstr(conf->cmdname, "server") != NULL) {
+        fprintf(stderr, "UDP GSO is not supported by servers with multiple "
+                        "threads\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Replayed payloads do not carry the checksum of synthetic ones
+    if (conf->replay.path != NULL && conf->touch_data) {
+        fprintf(stderr, "Replay is not compatible with -c\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (conf->pkt_size < MIN_PKT_SIZE || conf->pkt_size > MAX_PKT_SIZE) {
+        fprintf(stderr, "Packet size must be between %d and %d bytes\n",
+                MIN_PKT_SIZE, MAX_PKT_SIZE);
+        exit(EXIT_FAILURE);
+    }
+
+    // Frames are stored in buffers of fixed size by these sockets
+    if (conf->pkt_size > MAX_STD_PKT_SIZE &&
+        ((conf->sock_type & (NFV_SOCK_XDP | NFV_SOCK_SHM)) ||
+         ((conf->sock_type & NFV_SOCK_RAW) && conf->use_ring))) {
+        fprintf(stderr, "Packets bigger than %d bytes are not supported by "
+                        "AF_XDP, shared memory and PACKET_MMAP rings\n",
+                MAX_STD_PKT_SIZE);
+        exit(EXIT_FAILURE);
+    }
+
+    if (conf->dpdk.gso_size &&
+        ((conf->sock_type & NFV_SOCK_DPDK) == 0 ||
+         conf->dpdk.gso_size < MIN_PKT_SIZE ||
+         conf->dpdk.gso_size >= conf->pkt_size)) {
+        fprintf(stderr, "GSO is supported by DPDK sockets only, with a "
+                        "segment size between %d bytes and the packet size\n",
+                MIN_PKT_SIZE);
+        exit(EXIT_FAILURE);
+    }
+
+    // Static packets carry neither checksums nor meaningful timestamps
+    if (conf->dpdk.static_payloads &&
+        ((conf->sock_type & NFV_SOCK_DPDK) == 0 || conf->touch_data ||
+         conf->replay.path != NULL ||
+         strstr(conf->cmdname, "client") != NULL)) {
+        fprintf(stderr, "Static payloads are supported by DPDK send programs "
+                        "only, without -c or -I\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (conf->rate < 1) {
+        fprintf(stderr, "Rate must be at least 1 pps\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (conf->pacer.profile == PACER_PROFILE_ONOFF &&
+        (conf->pacer.on_us < 1 || conf->pacer.on_us > PACER_MAX_PHASE_US ||
+         conf->pacer.off_us < 1 || conf->pacer.off_us > PACER_MAX_PHASE_US)) {
+        fprintf(stderr, "On and off phases must last between 1 and %d us\n",
+                PACER_MAX_PHASE_US);
+        exit(EXIT_FAILURE);
+    }
+
+    // Replayed packets already carry their own timing
+    if (conf->pacer.profile != PACER_PROFILE_CBR && conf->replay.timing) {
+        fprintf(stderr, "Traffic profiles are not compatible with -T\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Trials change the rate, which these ones do not follow
+    if ((conf->search.ctrl != NULL || conf->search.max_delay_us != 0) &&
+        (conf->replay.timing || conf->pacer.profile == PACER_PROFILE_TRACE)) {
+        fprintf(stderr, "Rate search is not compatible with -T and trace "
+                        "profiles\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (conf->search.max_loss < 0 || conf->search.max_loss >= 1 ||
+        conf->search.trial_ms < 1) {
+        fprintf(stderr, "Search loss must be between 0 and 1 and trials "
+                        "must last at least 1 ms\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (conf->search.ctrl != NULL && conf->search.max_delay_us != 0) {
+        fprintf(stderr, "Loss (-Q) and latency (-K) searches are mutually "
+                        "exclusive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (conf->search.max_delay_us < 0 || conf->search.percentile <= 0 ||
+        conf->search.percentile > 100) {
+        fprintf(stderr, "Search delay target must be positive and percentile "
+                        "between 0 and 100\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (conf->capture.sampling < 1) {
+        fprintf(stderr, "Capture sampling must be at least 1\n");
+        exit(EXIT_FAILURE);
+    }
+
     // addr_port_number_set(conf->local.ip, conf->local.port_number);
     // addr_port_number_set(conf->remote.ip, conf->remote.port_number);
 
@@ -595,13 +1507,30 @@ int config_parse_arguments(struct config *conf, int argc, char *argv[]) {
 int config_initialize_socket(struct config *conf, int argc, char *argv[]) {
     switch (conf->sock_type) {
     case NFV_SOCK_DGRAM:
-        // Need additional flags?
-        return sock_create_dgram(conf, 0);
+        // With multiple threads, each one opens its own socket, see
+        // config_initialize_thread_socket
+        if (conf->num_threads > 1)
+            return 0;
+        return sock_init_dgram(conf);
     case NFV_SOCK_RAW:
+        // With multiple threads, each one opens its own socket, see
+        // config_initialize_thread_socket
+        if (conf->num_threads > 1)
+            return 0;
         // Need additional flags?
-        return sock_create_raw(&conf->sock_fd, conf->local_interf, 0);
+        return sock_create_raw(conf, 0);
     case NFV_SOCK_DPDK:
         return dpdk_init(argc, argv, conf);
+    case NFV_SOCK_XDP:
+        return xdp_init(conf);
+    case NFV_SOCK_URING:
+        // Rings are created by each socket object, by the thread using it
+        return sock_create_dgram(conf, 0);
+    case NFV_SOCK_SHM:
+        return shm_init(conf);
+    case NFV_SOCK_NULL:
+        // Nothing shared among sockets
+        return 0;
     default:
         break;
     }
@@ -610,6 +1539,34 @@ int config_initialize_socket(struct config *conf, int argc, char *argv[]) {
     return -1;
 }
 
+/**
+ * Initialize the sockets used by a single thread, given its own copy of the
+ * configuration. Only UDP and raw sockets are opened per thread (when multiple
+ * threads are used), all other ones are shared by all threads and initialized
+ * by config_initialize_socket.
+ *
+ * \return 0 on success, non-zero otherwise.
+ * */
+int config_initialize_thread_socket(struct config *conf) {
+    int res;
+
+    if (conf->num_threads < 2)
+        return 0;
+
+    switch (conf->sock_type) {
+    case NFV_SOCK_DGRAM:
+        return sock_init_dgram(conf);
+    case NFV_SOCK_RAW:
+        // Need additional flags?
+        res = sock_create_raw(conf, 0);
+        if (res == 0)
+            res = sock_setup_fanout(conf);
+        return res;
+    default:
+        return 0;
+    }
+}
+
 /**
  * Print the current configuration to stdout.
  * */
@@ -619,6 +1576,7 @@ void config_print(struct config *conf) {
     printf("rate (pps)\t%lu\n", conf->rate);
     printf("pkt size\t%lu\n", conf->pkt_size);
     printf("bst size\t%lu\n", conf->bst_size);
+    printf("threads\t\t%u\n", conf->num_threads);
 
     printf("sock type\t");
     switch (conf->sock_type) {
@@ -629,7 +1587,19 @@ void config_print(struct config *conf) {
         printf("raw");
         break;
     case NFV_SOCK_DPDK:
-        printf("dpdk");
+        printf(conf->dpdk.loopback ? "dpdk (loopback)" : "dpdk");
+        break;
+    case NFV_SOCK_XDP:
+        printf("xdp");
+        break;
+    case NFV_SOCK_URING:
+        printf("uring");
+        break;
+    case NFV_SOCK_SHM:
+        printf("shm (%s)", conf->shm.path);
+        break;
+    case NFV_SOCK_NULL:
+        printf("null");
         break;
     default:
         printf("ERROR!");
@@ -660,6 +1630,45 @@ void config_print(struct config *conf) {
     printf("mac remote\t%s\n", macstr);
 
     printf("using mmmsg API\t%s\n", conf->use_mmsg ? "yes" : "no");
+    printf("using mmap ring\t%s\n", conf->use_ring ? "yes" : "no");
+    printf("using UDP GSO\t%s\n", conf->use_gso ? "yes" : "no");
+    printf("using zerocopy\t%s\n", conf->use_zerocopy ? "yes" : "no");
+    printf("cpu steering\t%s\n", conf->use_cpu_steering ? "yes" : "no");
+    printf("flow rules\t%s\n", conf->dpdk.use_flows ? "yes" : "no");
+    printf("static payload\t%s\n",
+           conf->dpdk.static_payloads ? "yes" : "no");
+    if (conf->dpdk.gso_size)
+        printf("GSO\t\t%u\n", conf->dpdk.gso_size);
+    else
+        printf("GSO\t\tno\n");
+    if (conf->capture.path != NULL)
+        printf("capture\t\t%s (1/%u)\n", conf->capture.path,
+               conf->capture.sampling);
+    else
+        printf("capture\t\tno\n");
+    if (conf->replay.path != NULL)
+        printf("replay\t\t%s (%s)\n", conf->replay.path,
+               conf->replay.timing ? "original timing" : "rate");
+    else
+        printf("replay\t\tno\n");
+    printf("catch-up\t%s\n", catchup_names[conf->pacer.catchup]);
+    printf("spacing\t\t%s\n", conf->pacer.spacing ? "yes" : "no");
+    printf("profile\t\t%s", profile_names[conf->pacer.profile]);
+    if (conf->pacer.profile == PACER_PROFILE_ONOFF)
+        printf(" (on %u us, off %u us)", conf->pacer.on_us,
+               conf->pacer.off_us);
+    else if (conf->pacer.profile == PACER_PROFILE_TRACE)
+        printf(" (%s)", conf->pacer.trace_path);
+    printf("\n");
+    if (conf->search.ctrl != NULL)
+        printf("rate search\t%s (loss %g, %u ms trials)\n", conf->search.ctrl,
+               conf->search.max_loss, conf->search.trial_ms);
+    else if (conf->search.max_delay_us != 0)
+        printf("rate search\tp%g <= %g us (loss %g, %u ms trials)\n",
+               conf->search.percentile, conf->search.max_delay_us,
+               conf->search.max_loss, conf->search.trial_ms);
+    else
+        printf("rate search\tno\n");
     printf("silent\t\t%s\n", conf->silent ? "yes" : "no");
     printf("touch data\t%s\n", conf->touch_data ? "yes" : "no");
 
@@ -3,12 +3,16 @@
 #include <stdint.h>
 
 #include <rte_eal.h>
+#include <rte_eth_ring.h>
 #include <rte_ethdev.h>
+#include <rte_flow.h>
+#include <rte_ring.h>
 
 #include <rte_errno.h>
 
 #include "config.h"
 #include "dpdk.h"
+#include "hdr_tools.h"
 
 typedef unsigned int uint_t;
 
@@ -25,6 +29,16 @@ static const struct rte_eth_conf PORT_CONF_INIT = {
         },
 };
 
+/* Number of packets each software ring can hold in loopback mode */
+#define LOOPBACK_RING_SIZE 4096
+
+/* Incoming packets are spread among queues using their UDP 5-tuple */
+#define RSS_HASH_FUNCTIONS (ETH_RSS_IP | ETH_RSS_UDP)
+
+/* Priorities of the flow rules, lower values are matched first */
+#define FLOW_PRIORITY_ACCEPT 0
+#define FLOW_PRIORITY_DROP 1
+
 #define PRINT_DPDK_ERROR(str, ...)                                             \
     fprintf(stderr, "DPDK ERROR: " str, __VA_ARGS__)
 
@@ -64,97 +78,330 @@ static inline int get_cache_size(uint_t n_mbufs) {
     return b_divisor;
 }
 
-/* ---------------------------- Public Functions ---------------------------- */
-
 /**
- * Initialize DPDK environment with the appropriate parameters.
+ * Mempool object-init callback of the TX pool, see dpdk_init. Outgoing packets
+ * all have the same layout, so the mbuf fields describing it are set once
+ * here rather than at each allocation.
  *
- * This function should be invoked AFTER invoking the
- * config_parse_application_parameters function.
+ * Mbufs returned to the pool keep these values as long as the pool is only
+ * used by send loops, which never change them.
+ * */
+static void dpdk_tx_mbuf_init(struct rte_mempool *mp, void *opaque, void *obj,
+                              unsigned int obj_idx) {
+    struct config *conf = opaque;
+    struct rte_mbuf *pkt = obj;
+
+    (void)mp;
+    (void)obj_idx;
+
+    // Either one segment containing the whole packet or the header segment
+    // of a chained one, see dpdk_tx_payload_init
+    pkt->data_len = conf->dpdk.tx_chained ? PKT_HEADER_SIZE : conf->pkt_size;
+    pkt->pkt_len = conf->pkt_size;
+    pkt->l2_len = sizeof(struct rte_ether_hdr);
+    pkt->l3_len = sizeof(struct rte_ipv4_hdr);
+}
+
+/**
+ * Mempool object-init callback of the pool of payload segments, chained to
+ * header ones when packets do not fit in a single default-sized buffer.
+ * */
+static void dpdk_tx_payload_init(struct rte_mempool *mp, void *opaque,
+                                 void *obj, unsigned int obj_idx) {
+    struct config *conf = opaque;
+    struct rte_mbuf *seg = obj;
+
+    (void)mp;
+    (void)obj_idx;
+
+    seg->data_len = conf->payload_size;
+}
+
+/**
+ * Creates a pool of n_mbufs buffers of data_room bytes (headroom included) in
+ * hugepages memory of the given NUMA node.
  *
- * This means that it will operate on the parameters of the application starting
- * from the one equal to "--".
+ * \return the pool on success, NULL otherwise.
+ * */
+static struct rte_mempool *dpdk_pool_create(const char *name, uint_t n_mbufs,
+                                            uint16_t data_room,
+                                            int socket_id) {
+    struct rte_mempool *pool;
+
+    /* Set it to an even number (easier to determine cache size) */
+    if (n_mbufs & 0x01)
+        ++n_mbufs;
+
+    pool = rte_pktmbuf_pool_create(name, n_mbufs, get_cache_size(n_mbufs), 0,
+                                   data_room, socket_id);
+    if (pool == NULL)
+        PRINT_DPDK_ERROR("Unable to allocate %s: %s.\n", name,
+                         rte_strerror(rte_errno));
+
+    return pool;
+}
+
+/**
+ * Creates the pools new outgoing packets are built from on the given NUMA
+ * node, sized for n_threads sending threads. Buffers are initialized only
+ * once, see dpdk_tx_mbuf_init.
  *
- * \return 0 on success, an error code otherwise.
+ * \return 0 on success, -1 otherwise.
  * */
-int dpdk_init(int argc, char *argv[], struct config *conf) {
-    uint_t ports;   /* Number of ports available, must be equal to 1 for this
-                       application if DPDK is used. */
-    uint_t n_mbufs; /* Number of mbufs to create in a pool. */
-    uint_t port_id; /* The id of the DPDK port to be used. */
+static int dpdk_tx_pools_create(struct config *conf, uint_t node,
+                                uint_t n_threads,
+                                uint16_t tx_ring_descriptors) {
+    struct dpdk_tx_pools *pools = &conf->dpdk.tx_pools[node];
+    char name[RTE_MEMPOOL_NAMESIZE];
+    uint_t n_mbufs;
+    uint_t n_segs;
+
+    n_mbufs = RTE_MAX((tx_ring_descriptors + conf->bst_size) * n_threads + 512,
+                      8192U);
+
+    snprintf(name, sizeof(name), "tx_mbuf_pool_%u", node);
+    pools->packets = dpdk_pool_create(
+        name, n_mbufs,
+        RTE_PKTMBUF_HEADROOM +
+            (conf->dpdk.tx_chained ? PKT_HEADER_SIZE : conf->pkt_size),
+        node);
+    if (pools->packets == NULL)
+        return -1;
 
-    uint16_t tx_ring_descriptors, rx_ring_descriptors;
+    rte_mempool_obj_iter(pools->packets, dpdk_tx_mbuf_init, conf);
 
-    // FIXME: arbitrary numbers
-    switch (conf->dpdk.direction) {
-    case DIRECTION_TXRX:
-        tx_ring_descriptors = 2048;
-        rx_ring_descriptors = 2048;
-        break;
-    case DIRECTION_TX:
-        tx_ring_descriptors = 4096;
-        rx_ring_descriptors = 0;
-        break;
-    case DIRECTION_RX:
-        tx_ring_descriptors = 512;
-        rx_ring_descriptors = 4096;
-        break;
+    if (conf->dpdk.tx_chained) {
+        snprintf(name, sizeof(name), "tx_payload_pool_%u", node);
+        pools->payloads = dpdk_pool_create(
+            name, n_mbufs, RTE_PKTMBUF_HEADROOM + conf->payload_size, node);
+        if (pools->payloads == NULL)
+            return -1;
+
+        rte_mempool_obj_iter(pools->payloads, dpdk_tx_payload_init, conf);
     }
 
-    /* Give application parameters to DPDK initialization function */
-    int res = rte_eal_init(argc, argv);
+    if (conf->dpdk.gso_size) {
+        /* Each segment is made of a header buffer and an indirect one
+         * referencing the payload of the original packet */
+        n_segs = dpdk_gso_max_segs(conf);
+        n_mbufs = RTE_MAX((tx_ring_descriptors + conf->bst_size * n_segs) *
+                                  n_threads +
+                              512,
+                          8192U);
 
-    if (res < 0) {
-        PRINT_DPDK_ERROR("Unable to init RTE: %s.\n", rte_strerror(rte_errno));
-        return -1;
+        snprintf(name, sizeof(name), "gso_direct_pool_%u", node);
+        pools->gso_direct = dpdk_pool_create(
+            name, n_mbufs, RTE_PKTMBUF_HEADROOM + PKT_HEADER_SIZE, node);
+
+        snprintf(name, sizeof(name), "gso_indirect_pool_%u", node);
+        pools->gso_indirect = dpdk_pool_create(name, n_mbufs, 0, node);
+
+        if (pools->gso_direct == NULL || pools->gso_indirect == NULL)
+            return -1;
     }
 
-    /* Never used after this, useless operation */
-    /* argc -= res; */
-    /* argv += res; */
+    return 0;
+}
 
-    /* Get the number of DPDK ports available */
-    ports = rte_eth_dev_count_avail();
-    if (ports != 1) {
-        PRINT_DPDK_ERROR("Wrong number of ports, %d != 1.\n", ports);
+/**
+ * Validates and creates a single ingress flow rule on the given port.
+ *
+ * \return 0 on success, -1 if the device does not support the rule.
+ * */
+static int dpdk_flow_create(uint16_t port_id, uint32_t priority,
+                            const struct rte_flow_item pattern[],
+                            const struct rte_flow_action actions[]) {
+    struct rte_flow_attr attr = {
+        .group = 0,
+        .priority = priority,
+        .ingress = 1,
+    };
+    struct rte_flow_error error = {.message = NULL};
+
+    if (rte_flow_validate(port_id, &attr, pattern, actions, &error) ||
+        rte_flow_create(port_id, &attr, pattern, actions, &error) == NULL) {
+        fprintf(stderr, "DPDK WARNING: flow rule not supported: %s.\n",
+                error.message ? error.message : "unknown reason");
         return -1;
     }
 
-    /* Get the number of desired buffers and descriptors */
-    n_mbufs = RTE_MAX(
-        (rx_ring_descriptors + tx_ring_descriptors + conf->bst_size + 512),
-        8192U * 2);
-
-    /* Set it to an even number (easier to determine cache size) */
-    if (n_mbufs & 0x01)
-        ++n_mbufs;
+    return 0;
+}
 
-    /* Create the appropriate pool of buffers in hugepages memory. */
-    conf->dpdk.mbufs =
-        rte_pktmbuf_pool_create("mbuf_pool", n_mbufs, get_cache_size(n_mbufs),
-                                0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
-    if (conf->dpdk.mbufs == NULL) {
-        PRINT_DPDK_ERROR("Unable to allocate mbufs: %s.\n",
-                         rte_strerror(rte_errno));
-        return -1;
+/**
+ * Installs on the given port the flow rules that let the device itself filter
+ * the packets meant for this application, i.e. the ones that
+ * hdr_check_incoming_ports would accept, and drop all the other ones.
+ *
+ * Packets directed to the UDP port of the n-th thread (n > 0) are steered to
+ * its queue, so that replies reach the thread that sent the corresponding
+ * requests; packets directed to the first port, which are the only ones
+ * received by servers and receivers, are spread among all queues by RSS.
+ *
+ * Rules are installed all or none.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+static int dpdk_flow_setup(uint16_t port_id, struct config *conf) {
+    uint16_t nb_queues = conf->num_threads;
+    uint16_t queues[nb_queues];
+    uint16_t first_port;
+    struct pkt_hdr hdr;
+    struct rte_flow_error error;
+
+    pkt_hdr_setup(&hdr, conf, DIR_INCOMING);
+    first_port = rte_be_to_cpu_16(hdr.udp.dst_port);
+
+    for (uint16_t q = 0; q < nb_queues; ++q)
+        queues[q] = q;
+
+    struct rte_flow_item_eth eth_spec = {.dst = hdr.ether.d_addr};
+    struct rte_flow_item_eth eth_mask = {
+        .dst.addr_bytes = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+    };
+    struct rte_flow_item_ipv4 ip_spec = {.hdr.dst_addr = hdr.ip.dst_addr};
+    struct rte_flow_item_ipv4 ip_mask = {.hdr.dst_addr = 0xFFFFFFFF};
+    struct rte_flow_item_udp udp_spec = {.hdr.dst_port = 0};
+    struct rte_flow_item_udp udp_mask = {.hdr.dst_port = 0xFFFF};
+
+    struct rte_flow_item pattern[] = {
+        {.type = RTE_FLOW_ITEM_TYPE_ETH, .spec = &eth_spec, .mask = &eth_mask},
+        {.type = RTE_FLOW_ITEM_TYPE_IPV4, .spec = &ip_spec, .mask = &ip_mask},
+        {.type = RTE_FLOW_ITEM_TYPE_UDP, .spec = &udp_spec, .mask = &udp_mask},
+        {.type = RTE_FLOW_ITEM_TYPE_END},
+    };
+    struct rte_flow_item drop_pattern[] = {
+        {.type = RTE_FLOW_ITEM_TYPE_ETH},
+        {.type = RTE_FLOW_ITEM_TYPE_END},
+    };
+
+    struct rte_flow_action_queue queue;
+    struct rte_flow_action_rss rss = {
+        .func = RTE_ETH_HASH_FUNCTION_DEFAULT,
+        .level = 0,
+        .types = RSS_HASH_FUNCTIONS,
+        .key_len = 0,
+        .queue_num = nb_queues,
+        .key = NULL,
+        .queue = queues,
+    };
+
+    struct rte_flow_action actions[] = {
+        {.type = RTE_FLOW_ACTION_TYPE_QUEUE, .conf = &queue},
+        {.type = RTE_FLOW_ACTION_TYPE_END},
+    };
+    struct rte_flow_action drop_actions[] = {
+        {.type = RTE_FLOW_ACTION_TYPE_DROP},
+        {.type = RTE_FLOW_ACTION_TYPE_END},
+    };
+
+    for (uint16_t q = 0; q < nb_queues; ++q) {
+        udp_spec.hdr.dst_port = rte_cpu_to_be_16(first_port + q);
+
+        if (q == 0 && nb_queues > 1) {
+            actions[0].type = RTE_FLOW_ACTION_TYPE_RSS;
+            actions[0].conf = &rss;
+        } else {
+            queue.index = q;
+            actions[0].type = RTE_FLOW_ACTION_TYPE_QUEUE;
+            actions[0].conf = &queue;
+        }
+
+        if (dpdk_flow_create(port_id, FLOW_PRIORITY_ACCEPT, pattern, actions))
+            goto error;
     }
 
+    if (dpdk_flow_create(port_id, FLOW_PRIORITY_DROP, drop_pattern,
+                         drop_actions))
+        goto error;
+
+    return 0;
+
+error:
+    rte_flow_flush(port_id, &error);
+    return -1;
+}
+
+/**
+ * Configures and starts the given port, with one RX/TX queue pair for each
+ * thread of the application.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+static int dpdk_port_setup(uint16_t port_id, struct config *conf,
+                           uint16_t rx_ring_descriptors,
+                           uint16_t tx_ring_descriptors) {
+    uint16_t nb_queues = conf->num_threads; /* One RX/TX queue per thread. */
+    uint16_t q;
+    int res;
+
     struct rte_eth_txconf txq_conf;
     struct rte_eth_conf local_port_conf = PORT_CONF_INIT;
     struct rte_eth_dev_info dev_info;
+    struct rte_ether_addr port_mac;
 
-    /* Since we checked that there must be only one port, its port id is 0. */
-    port_id = 0;
-    conf->dpdk.portid = port_id;
     rte_eth_dev_info_get(port_id, &dev_info);
 
-    /* If able to offload TX to device, do it */
-    if (dev_info.tx_offload_capa & DEV_TX_OFFLOAD_MBUF_FAST_FREE) {
+    /* If able to offload TX to device, do it. Fast free does not support
+     * static packets, which are always referenced more than once, nor
+     * packets made of segments from different pools. */
+    if ((dev_info.tx_offload_capa & DEV_TX_OFFLOAD_MBUF_FAST_FREE) &&
+        !conf->dpdk.static_payloads && !conf->dpdk.tx_chained &&
+        !conf->dpdk.gso_size) {
         local_port_conf.txmode.offloads |= DEV_TX_OFFLOAD_MBUF_FAST_FREE;
     }
 
+    /* Chained and GSO packets are made of multiple segments */
+    if (conf->dpdk.tx_chained || conf->dpdk.gso_size) {
+        if (dev_info.tx_offload_capa & DEV_TX_OFFLOAD_MULTI_SEGS)
+            local_port_conf.txmode.offloads |= DEV_TX_OFFLOAD_MULTI_SEGS;
+        else
+            fprintf(stderr, "DPDK WARNING: device does not advertise "
+                            "multi-segment TX support.\n");
+    }
+
+    /* Frames bigger than standard Ethernet ones need jumbo frames; the device
+     * may scatter them in multiple buffers if it cannot fit them in one */
+    if (conf->pkt_size + RTE_ETHER_CRC_LEN > RTE_ETHER_MAX_LEN) {
+        if (dev_info.max_rx_pktlen < conf->pkt_size + RTE_ETHER_CRC_LEN) {
+            PRINT_DPDK_ERROR("Device does not support frames of %lu "
+                             "bytes.\n",
+                             conf->pkt_size);
+            return -1;
+        }
+
+        local_port_conf.rxmode.max_rx_pkt_len =
+            conf->pkt_size + RTE_ETHER_CRC_LEN;
+        local_port_conf.rxmode.offloads |=
+            dev_info.rx_offload_capa &
+            (DEV_RX_OFFLOAD_JUMBO_FRAME | DEV_RX_OFFLOAD_SCATTER);
+    }
+
+    if (nb_queues > dev_info.max_rx_queues ||
+        nb_queues > dev_info.max_tx_queues) {
+        PRINT_DPDK_ERROR("Too many queues requested, %u > %u.\n", nb_queues,
+                         RTE_MIN(dev_info.max_rx_queues,
+                                 dev_info.max_tx_queues));
+        return -1;
+    }
+
+    /* With multiple queues, use RSS on the hash functions supported by the
+     * device (if any) */
+    if (nb_queues > 1) {
+        local_port_conf.rx_adv_conf.rss_conf.rss_key = NULL;
+        local_port_conf.rx_adv_conf.rss_conf.rss_hf =
+            RSS_HASH_FUNCTIONS & dev_info.flow_type_rss_offloads;
+
+        if (local_port_conf.rx_adv_conf.rss_conf.rss_hf != 0)
+            local_port_conf.rxmode.mq_mode = ETH_MQ_RX_RSS;
+        else
+            fprintf(stderr, "DPDK WARNING: device does not support RSS, "
+                            "all packets will be received on queue 0.\n");
+    }
+
     /* Configure device */
-    res = rte_eth_dev_configure(port_id, 1, 1, &local_port_conf);
+    res = rte_eth_dev_configure(port_id, nb_queues, nb_queues,
+                                &local_port_conf);
     if (res < 0) {
         PRINT_DPDK_ERROR("Cannot configure device: %s.\n",
                          rte_strerror(rte_errno));
@@ -175,23 +422,29 @@ int dpdk_init(int argc, char *argv[], struct config *conf) {
     // COMMAND LINE
     /* rte_eth_macaddr_get(port_id, &conf->dpdk.src_mac_addr); */
 
-    /* Configure TX queue */
+    /* Configure TX queues */
     txq_conf = dev_info.default_txconf;
     txq_conf.offloads = local_port_conf.txmode.offloads;
-    res = rte_eth_tx_queue_setup(port_id, 0, tx_ring_descriptors,
-                                 rte_eth_dev_socket_id(port_id), &txq_conf);
-    if (res < 0) {
-        PRINT_DPDK_ERROR("Cannot configure TX: %s.\n", rte_strerror(rte_errno));
-        return -1;
+    for (q = 0; q < nb_queues; ++q) {
+        res = rte_eth_tx_queue_setup(port_id, q, tx_ring_descriptors,
+                                     rte_eth_dev_socket_id(port_id), &txq_conf);
+        if (res < 0) {
+            PRINT_DPDK_ERROR("Cannot configure TX queue %u: %s.\n", q,
+                             rte_strerror(rte_errno));
+            return -1;
+        }
     }
 
-    /* Configure RX queue */
-    res = rte_eth_rx_queue_setup(port_id, 0, rx_ring_descriptors,
-                                 rte_eth_dev_socket_id(port_id), NULL,
-                                 conf->dpdk.mbufs);
-    if (res < 0) {
-        PRINT_DPDK_ERROR("Cannot configure RX: %s.\n", rte_strerror(rte_errno));
-        return -1;
+    /* Configure RX queues */
+    for (q = 0; q < nb_queues; ++q) {
+        res = rte_eth_rx_queue_setup(port_id, q, rx_ring_descriptors,
+                                     rte_eth_dev_socket_id(port_id), NULL,
+                                     conf->dpdk.mbufs);
+        if (res < 0) {
+            PRINT_DPDK_ERROR("Cannot configure RX queue %u: %s.\n", q,
+                             rte_strerror(rte_errno));
+            return -1;
+        }
     }
 
     /* Bring the device up */
@@ -201,6 +454,25 @@ int dpdk_init(int argc, char *argv[], struct config *conf) {
         return -1;
     }
 
+    /* Let the device filter incoming packets if requested and able to;
+     * software ports used in loopback mode have no flow support */
+    if (conf->dpdk.use_flows && !conf->dpdk.loopback) {
+        if (dpdk_flow_setup(port_id, conf) == 0) {
+            conf->dpdk.flow_filtered = true;
+        } else {
+            fprintf(stderr, "DPDK WARNING: cannot install flow rules, "
+                            "filtering packets in software.\n");
+        }
+    }
+
+    /* Promiscuous mode is needed only if the device would discard packets
+     * directed to the MAC address given on the command line */
+    rte_eth_macaddr_get(port_id, &port_mac);
+    if (conf->dpdk.flow_filtered &&
+        rte_is_same_ether_addr(
+            &port_mac, (struct rte_ether_addr *)conf->local.mac.sll_addr))
+        return 0;
+
     /* Enable promiscuous mode */
     /* NOTICE: The device will show packets that are not meant for the
      * device MAC address too.
@@ -210,6 +482,186 @@ int dpdk_init(int argc, char *argv[], struct config *conf) {
     return 0;
 }
 
+/**
+ * Creates a pair of ports backed by software rings (net_ring PMD), so that
+ * whatever is sent on a queue of either port is received on the same queue of
+ * the other one.
+ *
+ * Each port of the pair is used by one of the two sides of the test running
+ * in the same process, no NIC is needed. A single net_ring port would only
+ * loop packets back to itself, making both sides receive on the same queues.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+static int dpdk_loopback_create(struct config *conf) {
+    uint16_t nb_queues = conf->num_threads;
+    struct rte_ring *rings[2][nb_queues];
+    char name[RTE_RING_NAMESIZE];
+    int ports[2];
+
+    /* rings[i] carries packets sent by port i to the other port */
+    for (int i = 0; i < 2; ++i) {
+        for (uint16_t q = 0; q < nb_queues; ++q) {
+            snprintf(name, sizeof(name), "loopback_%d_%u", i, q);
+            rings[i][q] = rte_ring_create(name, LOOPBACK_RING_SIZE,
+                                          rte_socket_id(),
+                                          RING_F_SP_ENQ | RING_F_SC_DEQ);
+            if (rings[i][q] == NULL) {
+                PRINT_DPDK_ERROR("Cannot create loopback ring: %s.\n",
+                                 rte_strerror(rte_errno));
+                return -1;
+            }
+        }
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        snprintf(name, sizeof(name), "net_ring_loopback%d", i);
+        ports[i] = rte_eth_from_rings(name, rings[1 - i], nb_queues, rings[i],
+                                      nb_queues, rte_socket_id());
+        if (ports[i] < 0) {
+            PRINT_DPDK_ERROR("Cannot create loopback port: %s.\n",
+                             rte_strerror(rte_errno));
+            return -1;
+        }
+    }
+
+    conf->dpdk.portid = ports[0];
+    conf->dpdk.peer_portid = ports[1];
+
+    return 0;
+}
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+/**
+ * Initialize DPDK environment with the appropriate parameters.
+ *
+ * This function should be invoked AFTER invoking the
+ * config_parse_application_parameters function.
+ *
+ * This means that it will operate on the parameters of the application starting
+ * from the one equal to "--".
+ *
+ * In loopback mode, a pair of ports connected to each other is created instead
+ * of using the one given to EAL, see dpdk_loopback_create.
+ *
+ * \return 0 on success, an error code otherwise.
+ * */
+int dpdk_init(int argc, char *argv[], struct config *conf) {
+    uint_t ports;   /* Number of ports available, must be equal to 1 for this
+                       application if DPDK is used (and not in loopback
+                       mode). */
+    uint_t n_mbufs; /* Number of mbufs to create in a pool. */
+    uint_t n_ports = conf->dpdk.loopback ? 2 : 1; /* Number of ports used. */
+    uint_t node_lcores[RTE_MAX_NUMA_NODES] = {0}; /* Lcores on each node. */
+    uint_t lcore_id, node;
+    int rx_node; /* The NUMA node of the device. */
+
+    uint16_t tx_ring_descriptors, rx_ring_descriptors;
+
+    // FIXME: arbitrary numbers
+    switch (conf->dpdk.direction) {
+    case DIRECTION_TXRX:
+        tx_ring_descriptors = 2048;
+        rx_ring_descriptors = 2048;
+        break;
+    case DIRECTION_TX:
+        tx_ring_descriptors = 4096;
+        rx_ring_descriptors = 0;
+        break;
+    case DIRECTION_RX:
+        tx_ring_descriptors = 512;
+        rx_ring_descriptors = 4096;
+        break;
+    }
+
+    /* Give application parameters to DPDK initialization function */
+    int res = rte_eal_init(argc, argv);
+
+    if (res < 0) {
+        PRINT_DPDK_ERROR("Unable to init RTE: %s.\n", rte_strerror(rte_errno));
+        return -1;
+    }
+
+    /* Never used after this, useless operation */
+    /* argc -= res; */
+    /* argv += res; */
+
+    if (conf->dpdk.loopback) {
+        res = dpdk_loopback_create(conf);
+        if (res)
+            return -1;
+    } else {
+        /* Get the number of DPDK ports available */
+        ports = rte_eth_dev_count_avail();
+        if (ports != 1) {
+            PRINT_DPDK_ERROR("Wrong number of ports, %d != 1.\n", ports);
+            return -1;
+        }
+
+        /* Since we checked that there must be only one port, its port id is
+         * 0. */
+        conf->dpdk.portid = 0;
+    }
+
+    /* Get the number of desired buffers and descriptors. Packets received
+     * may also be sent back, so the RX pool must fill both rings. */
+    n_mbufs = RTE_MAX((rx_ring_descriptors + tx_ring_descriptors +
+                       conf->bst_size) * conf->num_threads * n_ports + 512,
+                      8192U * 2);
+
+    /* Received packets are written by the device, so their buffers are
+     * allocated on its NUMA node (when known). */
+    rx_node = rte_eth_dev_socket_id(conf->dpdk.portid);
+    if (rx_node == SOCKET_ID_ANY)
+        rx_node = rte_socket_id();
+
+    /* Received frames always fit in a single buffer, as required by
+     * nfv_socket_dpdk */
+    conf->dpdk.mbufs = dpdk_pool_create(
+        "mbuf_pool", n_mbufs,
+        RTE_MAX(RTE_MBUF_DEFAULT_BUF_SIZE,
+                RTE_PKTMBUF_HEADROOM + conf->pkt_size),
+        rx_node);
+    if (conf->dpdk.mbufs == NULL)
+        return -1;
+
+    /* New outgoing packets are written by workers instead, so each NUMA node
+     * with enabled lcores gets its own pools, sized for the threads it may
+     * run. Packets that do not fit in a default-sized buffer are made of a
+     * header segment chained to a payload one. */
+    conf->dpdk.tx_chained = conf->pkt_size > RTE_MBUF_DEFAULT_DATAROOM;
+
+    RTE_LCORE_FOREACH(lcore_id) {
+        ++node_lcores[rte_lcore_to_socket_id(lcore_id)];
+    }
+
+    for (node = 0; node < RTE_MAX_NUMA_NODES; ++node) {
+        if (node_lcores[node] == 0)
+            continue;
+
+        res = dpdk_tx_pools_create(
+            conf, node, RTE_MIN(node_lcores[node], conf->num_threads) * n_ports,
+            tx_ring_descriptors);
+        if (res)
+            return -1;
+    }
+
+    res = dpdk_port_setup(conf->dpdk.portid, conf, rx_ring_descriptors,
+                          tx_ring_descriptors);
+    if (res)
+        return -1;
+
+    if (conf->dpdk.loopback) {
+        res = dpdk_port_setup(conf->dpdk.peer_portid, conf,
+                              rx_ring_descriptors, tx_ring_descriptors);
+        if (res)
+            return -1;
+    }
+
+    return 0;
+}
+
 /**
  * For receiver-only applications. From time to time, this function can be
  * invoked to send an empty frame to the device.
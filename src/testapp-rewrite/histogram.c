@@ -0,0 +1,73 @@
+/* -------------------------------- Includes -------------------------------- */
+
+#include <math.h>
+#include <string.h>
+
+#include <rte_common.h>
+
+#include "histogram.h"
+
+/* --------------------------- Private Functions ---------------------------- */
+
+/**
+ * Returns the highest value counted in the given bucket.
+ * */
+static inline uint64_t histogram_bucket_max(unsigned int index) {
+    unsigned int shift;
+
+    if (index < 2 * HISTOGRAM_SUB_HALF)
+        return index;
+
+    shift = index / HISTOGRAM_SUB_HALF - 1;
+
+    return ((index % HISTOGRAM_SUB_HALF + HISTOGRAM_SUB_HALF + 1) << shift) -
+           1;
+}
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+void histogram_reset(struct histogram *h) { memset(h, 0, sizeof(*h)); }
+
+/**
+ * Adds the values counted in src to the ones counted in dst.
+ * */
+void histogram_merge(struct histogram *dst, const struct histogram *src) {
+    if (src->total == 0)
+        return;
+
+    if (src->min < dst->min || dst->total == 0)
+        dst->min = src->min;
+    if (src->max > dst->max)
+        dst->max = src->max;
+
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+        dst->counts[i] += src->counts[i];
+
+    dst->total += src->total;
+    dst->sum += src->sum;
+}
+
+/**
+ * Returns the given percentile (between 0 and 100) of the counted values, as
+ * the highest value of the bucket it falls in (but not above the highest value
+ * counted), so that the real percentile is never underestimated. Returns 0 if
+ * the histogram is empty.
+ * */
+uint64_t histogram_percentile(const struct histogram *h, double percentile) {
+    uint64_t rank = ceil(h->total * percentile / 100.);
+    uint64_t seen = 0;
+
+    if (h->total == 0)
+        return 0;
+
+    // The rank-th value, counting from 1 (nearest-rank method)
+    rank = RTE_MAX(RTE_MIN(rank, h->total), (uint64_t)1);
+
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += h->counts[i];
+        if (seen >= rank)
+            return RTE_MIN(histogram_bucket_max(i), h->max);
+    }
+
+    return h->max;
+}
@@ -0,0 +1,151 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_branch_prediction.h>
+#include <rte_memory.h>
+
+#include "config.h"
+#include "constants.h"
+#include "hdr_tools.h"
+#include "nfv_socket.h"
+#include "pcap.h"
+#include "timestamp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------- Constants -------------------------------- */
+
+#define CAPTURE_RING_SIZE 1024        /* Slots in each ring, a power of 2 */
+#define CAPTURE_SNAPLEN MAX_PKT_SIZE  /* Maximum captured frame [bytes] */
+
+/* ---------------------------- Type definitions ---------------------------- */
+
+/**
+ * A captured frame, preceded by its pcap record header so that both can be
+ * written to the file at once.
+ * */
+struct capture_slot {
+    tsc_t tsc; /* Converted to the record timestamp by the writer */
+    struct pcap_rec_hdr rec;
+    byte_t frame[CAPTURE_SNAPLEN];
+};
+
+/**
+ * A single-producer/single-consumer ring of captured frames, one for each
+ * receiving thread. The producer never waits for the writer: frames that do
+ * not fit in the ring are only counted.
+ * */
+struct capture_ring {
+    uint64_t head __rte_cache_aligned; /* Written by the producer only */
+    uint64_t tail __rte_cache_aligned; /* Written by the consumer only */
+
+    /* Used by the producer only, except stop */
+    bool stop __rte_cache_aligned; /* Set once by capture_close */
+    unsigned int sampling;
+    unsigned int countdown; /* Packets to be skipped before the next one */
+    uint64_t dropped;       /* Sampled frames that did not fit in the ring */
+    struct pkt_hdr hdr;     /* Used when sockets do not expose frames */
+
+    struct capture_slot slots[CAPTURE_RING_SIZE] __rte_cache_aligned;
+};
+
+/**
+ * The capture file and the rings it is filled from.
+ * */
+struct capture {
+    FILE *file;
+    uint64_t written; /* Records written to the file */
+    uint64_t lost;    /* Records not written because of write errors */
+    bool failed;      /* Whether writing to the file failed */
+
+    bool stop;           /* Set by capture_close to stop the writer */
+    bool writer_stopped; /* Set by the writer once stopped */
+
+    tsc_t tsc_hz;
+    tsc_t tsc_base;   /* The TSC value corresponding to ns_base */
+    uint64_t ns_base; /* Wall-clock time when capture started [ns] */
+
+    unsigned int nb_rings;
+    struct capture_ring *rings[MAX_THREADS];
+};
+
+/* ------------------------ Producer-side functions ------------------------- */
+
+/**
+ * Copies in the ring the sampled packets among the given received ones.
+ *
+ * Whole frames are copied from sockets that receive them in memory (see
+ * frame_headroom); for the other ones the frame is rebuilt from the expected
+ * incoming header and the payload.
+ * */
+static inline void capture_burst(struct capture_ring *ring,
+                                 nfv_socket_ptr socket, buffer_t buffers[],
+                                 ssize_t howmany) {
+    const uint32_t frame_len = socket->packet_size;
+    uint64_t head = ring->head;
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    struct capture_slot *slot;
+    tsc_t tsc = 0;
+
+    // The rings are being drained to the file for the last time
+    if (unlikely(__atomic_load_n(&ring->stop, __ATOMIC_RELAXED)))
+        return;
+
+    for (ssize_t i = 0; i < howmany; ++i) {
+        if (--ring->countdown)
+            continue;
+        ring->countdown = ring->sampling;
+
+        if (unlikely(head - tail >= CAPTURE_RING_SIZE)) {
+            ++ring->dropped;
+            continue;
+        }
+
+        // All packets of the same burst share the same timestamp
+        if (tsc == 0)
+            tsc = tsc_read();
+
+        slot = &ring->slots[head & (CAPTURE_RING_SIZE - 1)];
+        slot->tsc = tsc;
+        slot->rec.caplen = frame_len;
+        slot->rec.len = frame_len;
+
+        if (socket->frame_headroom) {
+            memcpy(slot->frame, buffers[i] - socket->frame_headroom,
+                   frame_len);
+        } else {
+            memcpy(slot->frame, &ring->hdr, PKT_HEADER_SIZE);
+            memcpy(slot->frame + PKT_HEADER_SIZE, buffers[i],
+                   socket->payload_size);
+        }
+
+        ++head;
+    }
+
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+}
+
+/* -------------------------------- FUNCTIONS --------------------------------*/
+
+extern int capture_init(struct config *conf);
+
+extern struct capture_ring *capture_ring_attach(struct config *conf);
+
+extern ssize_t capture_write(struct capture *capture);
+
+extern void capture_close(struct capture *capture);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // CAPTURE_H
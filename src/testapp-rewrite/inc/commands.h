@@ -12,6 +12,9 @@ extern int clientst_body(int argc, char *argv[]);
 extern int recv_body(int argc, char *argv[]);
 extern int send_body(int argc, char *argv[]);
 
+extern int loopback_body(int argc, char *argv[]);
+extern int loopback_client_body(int argc, char *argv[]);
+
 // CUSTOM FUNCTIONS FOR DPDK ARE NO NEEDED ANYMORE NOW THAT THE FRAMEWORK IS
 // GENERIC! USE THE SAME BODIES AS THE OTHERS!
 
@@ -27,11 +30,13 @@ typedef int (*main_body_t)(int, char **);
 static const char *const commands_n[] = {
     "server",      "client",      "clientst",      "send",      "recv",
     "dpdk-server", "dpdk-client", "dpdk-clientst", "dpdk-send", "dpdk-recv",
+    "dpdk-loopback", "dpdk-loopback-client",
 };
 
 static const main_body_t commands_f[] = {
     server_body, client_body, clientst_body, send_body, recv_body,
     server_body, client_body, clientst_body, send_body, recv_body,
+    loopback_body, loopback_client_body,
 };
 
 static const int num_commands = sizeof(commands_f) / sizeof(main_body_t);
@@ -8,7 +8,8 @@
 #include <stdint.h>
 
 #include <netinet/in.h>
-#include <netpacket/packet.h>
+#include <netinet/udp.h>
+#include <linux/if_packet.h>
 
 // #include "nfv_socket.h"
 
@@ -22,6 +23,10 @@ enum nfv_sock_type {
     NFV_SOCK_DGRAM = 0x1,
     NFV_SOCK_RAW = 0x2,
     NFV_SOCK_DPDK = 0x4,
+    NFV_SOCK_XDP = 0x8,
+    NFV_SOCK_URING = 0x10,
+    NFV_SOCK_SHM = 0x20,
+    NFV_SOCK_NULL = 0x40,
 };
 
 enum comm_dir {
@@ -32,6 +37,28 @@ enum comm_dir {
 
 #define NFV_SOCK_SIMPLE (NFV_SOCK_DGRAM | NFV_SOCK_RAW)
 
+/* Socket options and flags not defined by older C libraries */
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
+/* Socket types available to Linux-based (i.e. non-DPDK) configurations */
+#define NFV_SOCK_LINUX                                                         \
+    (NFV_SOCK_SIMPLE | NFV_SOCK_XDP | NFV_SOCK_URING | NFV_SOCK_SHM |          \
+     NFV_SOCK_NULL)
+
 /* ---------------------------- Type definitions ---------------------------- */
 
 #define RAW_ADDRSTRLEN 18
@@ -55,13 +82,104 @@ struct portaddr {
     struct sockaddr_ll mac;
 };
 
+/**
+ * The mempools new outgoing packets are built from, all on the same NUMA
+ * node. Pools other than packets are NULL when not needed.
+ * */
+struct dpdk_tx_pools {
+    struct rte_mempool *packets;      /* Packets, or their headers if chained */
+    struct rte_mempool *payloads;     /* Payloads of chained packets */
+    struct rte_mempool *gso_direct;   /* Headers of GSO segments */
+    struct rte_mempool *gso_indirect; /* Payloads of GSO segments */
+};
+
 struct dpdk_conf {
-    /* NOTE: always zero */
+    /* NOTE: always zero, unless in loopback mode */
     dpdk_port_t portid;
+    bool loopback; /* Whether a pair of software ports connected to each other
+                      shall be used instead of a real one, see dpdk.c */
+    dpdk_port_t peer_portid; /* The port used by the peer (loopback only) */
+    bool use_flows;     /* Whether the device shall filter incoming packets
+                           using flow rules, see dpdk.c */
+    bool flow_filtered; /* Whether flow rules were actually installed, so
+                           that packets need no checks in software */
+    bool static_payloads; /* Whether the same prepared packets shall be sent
+                             over and over, see nfv_socket_dpdk.c */
+    bool tx_chained; /* Whether outgoing packets are too big for a single
+                        buffer and are chained to a payload one, see
+                        dpdk.c */
+    uint16_t gso_size; /* Maximum size of the segments outgoing packets are
+                          split in by librte_gso, zero if disabled */
     enum comm_dir direction; /* Indicates whether this application will only
                                 send, only receive, or both */
     struct rte_mempool
         *mbufs; /* Pointer to the mempool to take DPDK buffers from */
+    struct dpdk_tx_pools
+        tx_pools[RTE_MAX_NUMA_NODES]; /* Mempools of new outgoing packets,
+                                         one set per NUMA node with lcores */
+};
+
+struct xdp_conf {
+    uint32_t queue_id;      /* The interface queue the socket is bound to */
+    struct xdp_socket *xsk; /* Pointer to the AF_XDP socket and its UMEM */
+};
+
+struct shm_conf {
+    const char *path;         /* The file shared with the other application */
+    struct shm_channel *chan; /* Pointer to the mapped rings and buffers */
+};
+
+struct capture_conf {
+    const char *path;       /* The pcap file received packets are written to,
+                               NULL if capture is disabled */
+    unsigned int sampling;  /* One packet every sampling is captured */
+    struct capture *capture; /* Pointer to the file and rings, see capture.c */
+};
+
+struct replay_conf {
+    const char *path;      /* The pcap file replayed by send loops, NULL if
+                              synthetic payloads shall be sent instead */
+    bool timing;           /* Whether the original timing of the file shall
+                              be followed, instead of the configured rate */
+    struct replay *replay; /* Pointer to the preloaded trace, see replay.c */
+};
+
+enum pacer_catchup {
+    PACER_CATCHUP_BURST = 0, /* Late packets are all sent back-to-back */
+    PACER_CATCHUP_CAP,       /* Up to a few late bursts are sent back-to-back */
+    PACER_CATCHUP_SKIP,      /* Late packets are not sent at all */
+};
+
+enum pacer_profile {
+    PACER_PROFILE_CBR = 0, /* Constant gaps between departures */
+    PACER_PROFILE_POISSON, /* Exponentially distributed gaps */
+    PACER_PROFILE_ONOFF,   /* Constant gaps in on phases, none in off ones */
+    PACER_PROFILE_TRACE,   /* Gaps read from a file */
+};
+
+struct pacer_conf {
+    enum pacer_catchup catchup; /* What sending loops do when they are late
+                                   on their schedule, see pacer.h */
+    bool spacing; /* Whether packets of a burst shall depart one by one at
+                     the configured rate, instead of all at once */
+    enum pacer_profile profile; /* How gaps between departures are drawn */
+    unsigned int on_us;  /* Duration of on phases [us] (on/off only) */
+    unsigned int off_us; /* Duration of off phases [us] (on/off only) */
+    const char *trace_path;    /* File of gaps [ns] (trace only) */
+    struct pacer_trace *trace; /* Pointer to the loaded gaps, see pacer.c */
+};
+
+struct search_conf {
+    const char *ctrl;      /* Control channel address (<ip>:<port>) of the
+                              receiver, NULL if no search shall be run */
+    double max_loss;       /* Highest fraction of packets that may be lost
+                              at the rate found by the search */
+    unsigned int trial_ms; /* Duration of each trial [ms] */
+    double max_delay_us;   /* Highest round-trip delay percentile [us] at
+                              the rate found by the search, 0 if no latency
+                              search shall be run */
+    double percentile;     /* Percentile of delays compared to the target */
+    struct search *search; /* Pointer to the shared state, see search.c */
 };
 
 // enum nfv_sock_type
@@ -80,10 +198,27 @@ struct config {
     size_t payload_size; /* Payload size [bytes] */
     size_t bst_size;     /* Burst size [packets] */
 
+    unsigned int num_threads; /* Number of threads running each packet loop */
+    unsigned int thread_id;   /* Index of the thread this copy of the
+                                 configuration belongs to, among the ones
+                                 running the same loop */
+    bool is_peer; /* Whether this copy of the configuration belongs to the
+                     peer side of a loopback test (DPDK loopback only) */
+
     bool use_block; /* Whether the sockets shall be configured to be blocking or
                        non-blocking [system socket only] */
     bool use_mmsg;  /* Whether the *mmsg variants of kernel socket system calls
                        shall be used [system socket only] */
+    bool use_ring;  /* Whether PACKET_MMAP rings shall be used instead of
+                       system calls for each packet [raw socket only] */
+    bool use_gso;   /* Whether UDP segmentation and receive offloads shall be
+                       used to exchange whole bursts [UDP socket only] */
+    bool use_zerocopy; /* Whether outgoing payloads shall be sent without
+                          copying them in the kernel [UDP socket only] */
+    bool use_cpu_steering; /* Whether incoming packets shall be steered to
+                              the socket of the thread with index equal to
+                              the receiving CPU modulo the number of threads
+                              [multi-threaded UDP socket only] */
 
     bool silent; /* Whether the application should print periodically data to
                     standard output */
@@ -103,12 +238,28 @@ struct config {
     int sock_fd; /* Socket file descriptor (NFC_SOCK_DGRAM or NFV_SOCK_RAW only)
                   */
 
+    struct packet_ring *raw_ring; /* PACKET_MMAP rings mapped on sock_fd
+                                     (NFV_SOCK_RAW with use_ring only) */
+
     char local_interf[16]; /* The name of the local interface to be used
-                              (NFV_SOCK_RAW only) */
+                              (NFV_SOCK_RAW or NFV_SOCK_XDP only) */
 
     struct dpdk_conf
         dpdk; /* DPDK-related configuration only (NFC_SOCK_DPDK only) */
 
+    struct xdp_conf xdp; /* AF_XDP-related configuration (NFV_SOCK_XDP only) */
+
+    struct shm_conf shm; /* Shared memory configuration (NFV_SOCK_SHM only) */
+
+    struct capture_conf capture; /* Capture of received packets, any socket */
+
+    struct replay_conf replay; /* Replay of a pcap file, any socket */
+
+    struct pacer_conf pacer; /* Pacing of sending loops, any socket */
+
+    struct search_conf search; /* Rate search, loss-driven for send and recv,
+                                  latency-driven for clients */
+
     char *cmdname;
 };
 
@@ -134,6 +285,7 @@ extern void config_initialize(struct config *conf,
 extern int config_parse_arguments(struct config *conf, int argc, char *argv[]);
 extern int config_initialize_socket(struct config *conf, int argc,
                                     char *argv[]);
+extern int config_initialize_thread_socket(struct config *conf);
 extern void config_print(struct config *conf);
 
 #define PKT_SIZE_TO_PAYLOAD(pkt_size) ((pkt_size)-PKT_HEADER_SIZE)
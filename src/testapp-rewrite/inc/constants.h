@@ -20,9 +20,15 @@ extern "C" {
 #define DEFAULT_RATE 10000000 /* Default Transmission Rate [pps]] */
 #define DEFAULT_PKT_SIZE 64   /* Default packet size [bytes] */
 #define DEFAULT_BST_SIZE 32   /* Default burst size [# of packkets] */
+#define DEFAULT_THREADS 1     /* Default threads running each packet loop */
+
+#define MAX_THREADS 64 /* Maximum threads running each packet loop */
 
 #define MIN_PKT_SIZE 64   /* Minimum acceptable packet size [bytes] */
-#define MAX_PKT_SIZE 1500 /* Maximum acceptable packet size [bytes] */
+#define MAX_PKT_SIZE 9000 /* Maximum acceptable packet size, with jumbo
+                             frames [bytes] */
+#define MAX_STD_PKT_SIZE 1500 /* Maximum packet size of sockets using
+                                 fixed-size buffers [bytes] */
 
 /* TODO: move port numbers somewhere else */
 #define SEND_PORT 13994
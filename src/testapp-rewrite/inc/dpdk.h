@@ -1,10 +1,29 @@
 #ifndef DPDK_MINE_H
 #define DPDK_MINE_H
 
+/* -------------------------------- Includes -------------------------------- */
+
+#include "config.h"
+#include "constants.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* --------------------------- Inline Functions ----------------------------- */
+
+/**
+ * Returns the maximum number of segments librte_gso splits each outgoing
+ * packet in. Segments are IP fragments, so each one but the last carries a
+ * multiple of 8 bytes of the IP payload.
+ * */
+static inline unsigned int dpdk_gso_max_segs(const struct config *conf) {
+    const unsigned int hdr_size = OFFSET_PKT_UDP - OFFSET_PKT_ETHER;
+    const unsigned int unit = (conf->dpdk.gso_size - hdr_size) & ~7U;
+
+    return (conf->pkt_size - hdr_size + unit - 1) / unit;
+}
+
 /* -------------------------------- FUNCTIONS --------------------------------*/
 
 extern int dpdk_init(int argc, char *argv[], struct config *conf);
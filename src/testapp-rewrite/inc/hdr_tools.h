@@ -97,8 +97,26 @@ static inline void swap_udp_port(struct rte_udp_hdr *hdr) {
     swap_ptrs(src_port, dst_port, &support, sizeof(uint16_t));
 }
 
-static inline bool hdr_check_incoming(const struct pkt_hdr *received_hdr,
-                                      const struct pkt_hdr *expected_hdr) {
+/**
+ * Moves the source UDP port of the given header by offset ports, so that
+ * packets sent by different threads belong to different flows.
+ * */
+static inline void hdr_offset_src_port(struct pkt_hdr *hdr, uint16_t offset) {
+    uint16_t port = rte_be_to_cpu_16(hdr->udp.src_port);
+    hdr->udp.src_port = rte_cpu_to_be_16((uint16_t)(port + offset));
+}
+
+/**
+ * Checks the destination of the received header against the expected one.
+ * Any of the nb_ports destination UDP ports starting from the expected one is
+ * accepted, since replies to each thread of the remote application may be
+ * steered to any of the local ones.
+ * */
+static inline bool hdr_check_incoming_ports(const struct pkt_hdr *received_hdr,
+                                            const struct pkt_hdr *expected_hdr,
+                                            uint16_t nb_ports) {
+    uint16_t port_offset;
+
     // Check if destination MAC address is correct
     if (!rte_is_same_ether_addr(&received_hdr->ether.d_addr,
                                 &expected_hdr->ether.d_addr))
@@ -109,12 +127,19 @@ static inline bool hdr_check_incoming(const struct pkt_hdr *received_hdr,
         return false;
 
     // Check if destination UDP port is correct
-    if (received_hdr->udp.dst_port != expected_hdr->udp.dst_port)
+    port_offset = rte_be_to_cpu_16(received_hdr->udp.dst_port) -
+                  rte_be_to_cpu_16(expected_hdr->udp.dst_port);
+    if (port_offset >= nb_ports)
         return false;
 
     return true;
 }
 
+static inline bool hdr_check_incoming(const struct pkt_hdr *received_hdr,
+                                      const struct pkt_hdr *expected_hdr) {
+    return hdr_check_incoming_ports(received_hdr, expected_hdr, 1);
+}
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
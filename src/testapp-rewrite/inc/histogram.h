@@ -0,0 +1,88 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------- Constants -------------------------------- */
+
+/* Values below 2^HISTOGRAM_SUB_BITS have a bucket each, larger ones share a
+ * bucket with the ones equal in their HISTOGRAM_SUB_BITS most significant
+ * bits, i.e. buckets are at most 1/2^(HISTOGRAM_SUB_BITS-1) of their value */
+#define HISTOGRAM_SUB_BITS 7
+#define HISTOGRAM_SUB_HALF (1UL << (HISTOGRAM_SUB_BITS - 1))
+
+/* Values from 2^HISTOGRAM_MAX_BITS on are all counted in the last bucket */
+#define HISTOGRAM_MAX_BITS 40
+
+#define HISTOGRAM_BUCKETS                                                      \
+    ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_SUB_HALF)
+
+/* ---------------------------- Type definitions ---------------------------- */
+
+/**
+ * A log-linear histogram of values (e.g. delays in TSC cycles), with a
+ * relative error bounded by the number of sub-buckets, like HDR histograms.
+ * Recording a value costs a few instructions and no branch misprediction.
+ *
+ * A zeroed histogram is an empty one.
+ * */
+struct histogram {
+    uint64_t total; /* Values counted */
+    uint64_t sum;   /* Sum of values counted, for averages */
+    uint64_t min;   /* Exact lowest value counted (if any) */
+    uint64_t max;   /* Exact highest value counted (if any) */
+    uint64_t counts[HISTOGRAM_BUCKETS];
+};
+
+/* -------------------------- Hot-path functions ---------------------------- */
+
+/**
+ * Returns the index of the bucket the given value is counted in.
+ * */
+static inline unsigned int histogram_index(uint64_t value) {
+    unsigned int msb;
+
+    if (value < 2 * HISTOGRAM_SUB_HALF)
+        return value;
+
+    if (value >= 1ULL << HISTOGRAM_MAX_BITS)
+        return HISTOGRAM_BUCKETS - 1;
+
+    msb = 63 - __builtin_clzll(value);
+
+    return (msb - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_SUB_HALF +
+           (value >> (msb - HISTOGRAM_SUB_BITS + 1)) - HISTOGRAM_SUB_HALF;
+}
+
+static inline void histogram_record(struct histogram *h, uint64_t value) {
+    if (value < h->min || h->total == 0)
+        h->min = value;
+    if (value > h->max)
+        h->max = value;
+
+    ++h->counts[histogram_index(value)];
+    ++h->total;
+    h->sum += value;
+}
+
+/* -------------------------------- FUNCTIONS --------------------------------*/
+
+extern void histogram_reset(struct histogram *h);
+
+extern void histogram_merge(struct histogram *dst,
+                            const struct histogram *src);
+
+extern uint64_t histogram_percentile(const struct histogram *h,
+                                     double percentile);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // HISTOGRAM_H
@@ -7,11 +7,13 @@
 #endif
 
 #include "config.h"
+#include "constants.h"
 #include "stats.h"
 
 /* -------------------- LOOP EXIT FUNCTION  DECLARATION --------------------- */
 
-extern struct stats *stats_ptr;
+extern struct stats *stats_ptrs[2][MAX_THREADS];
+extern struct capture *capture_ptr;
 extern void handle_sigint(int sig);
 
 /* ---------------------- LOOP FUNCTIONS  DECLARATIONS ---------------------- */
@@ -21,5 +23,7 @@ extern int send_loop(void *) __attribute__((noreturn));
 extern int recv_loop(void *) __attribute__((noreturn));
 extern int server_loop(void *) __attribute__((noreturn));
 extern int client_loop(void *) __attribute__((noreturn));
+extern int capture_loop(void *) __attribute__((noreturn));
+extern int search_loop(void *) __attribute__((noreturn));
 
 #endif /* LOOPS_H */
@@ -158,6 +158,9 @@ struct nfv_socket {
     /* const */ size_t packet_size;
     /* const */ size_t payload_size;
     /* const */ size_t burst_size;
+    /* const */ size_t frame_headroom; /* Bytes of each received frame that
+                                          precede its payload in memory, 0 if
+                                          only payloads are received */
 
     buffer_t *payloads;
 };
@@ -4,6 +4,7 @@
 #include "hdr_tools.h"
 #include "nfv_socket.h"
 
+#include <rte_gso.h>
 #include <rte_mbuf.h>
 
 /* ---------------------------- TYPE DEFINITIONS ---------------------------- */
@@ -47,7 +48,30 @@ struct nfv_socket_dpdk {
     rte_buffer_t *packets;
 
     int portid;
-    struct rte_mempool *mbufs;
+    uint16_t queueid; /* Both the RX and TX queue used by this socket */
+    uint16_t nb_ports; /* Number of local UDP ports packets may be sent to,
+                          one per thread */
+    bool hw_filtered;  /* Whether the device drops packets not meant for
+                          this application by itself */
+    struct dpdk_tx_pools tx_pools; /* Buffers already set up for sending */
+    rte_buffer_t *payload_segs; /* Payload segments of chained packets */
+
+    /* Whether received frames may be scattered in multiple buffers, that
+     * must be merged before handing payloads to the application */
+    bool rx_linearize;
+    struct rte_mempool *rx_pool; /* Single buffers frames are copied to
+                                    when they cannot be merged in place */
+
+    /* Software GSO, if used each packet is sent as many IP fragments */
+    uint16_t gso_size;
+    struct rte_gso_ctx gso_ctx;
+    rte_buffer_t *gso_segs; /* Segments of the packets of a burst */
+    size_t gso_segs_size;
+    uint16_t *gso_counts; /* The number of segments of each packet */
+
+    /* Static payload mode, if used the same packets are sent by each burst */
+    bool static_payloads;
+    rte_buffer_t *static_packets;
 
     size_t active_buffers;
     size_t used_buffers;
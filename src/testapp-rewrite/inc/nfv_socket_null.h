@@ -0,0 +1,67 @@
+#ifndef NFV_SOCKET_NULL_H
+#define NFV_SOCKET_NULL_H
+
+#include "hdr_tools.h"
+#include "nfv_socket.h"
+
+/* ---------------------------- TYPE DEFINITIONS ---------------------------- */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* -------------------- MACROS (FOR FUNCTION PROTOTYPES) -------------------- */
+
+#define NFV_NULL_SIGNATURE(return_t, name, ...)                                \
+    NFV_SIGNATURE(return_t, null_##name, ##__VA_ARGS__)
+
+/* ----------------------- CLASS FUNCTION PROTOTYPES ------------------------ */
+
+extern NFV_NULL_SIGNATURE(void, init, config_ptr conf);
+
+extern NFV_NULL_SIGNATURE(size_t, request_out_buffers, buffer_t buffers[],
+                          size_t howmany);
+
+extern NFV_NULL_SIGNATURE(ssize_t, send, size_t howmany);
+
+extern NFV_NULL_SIGNATURE(ssize_t, recv, buffer_t buffers[], size_t howmany);
+
+extern NFV_NULL_SIGNATURE(ssize_t, send_back, size_t howmany);
+
+/* ---------------------------- CLASS DEFINITION ---------------------------- */
+
+/**
+ * A socket that involves neither the kernel nor a device: sent packets are
+ * discarded and received ones are taken, in order, from a ring of packets
+ * built once at initialization.
+ *
+ * It measures the maximum packet rate that the application loops can sustain,
+ * hence whether a measurement is bottlenecked by the application itself.
+ *
+ * NOTICE: received packets carry no meaningful timestamp, hence this socket
+ * is not meant to measure latency.
+ * */
+struct nfv_socket_null {
+    /* Base class holder */
+    struct nfv_socket super;
+
+    /* Header structures, the same for each message */
+    struct pkt_hdr outgoing_hdr;
+    struct pkt_hdr incoming_hdr;
+
+    /* Packets handed out for sending, one per burst element */
+    byte_t *tx_area;
+
+    /* Packets handed out on receive, in order */
+    byte_t *rx_area;
+    size_t rx_next;
+
+    size_t active_buffers;
+    size_t used_buffers;
+};
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* NFV_SOCKET_NULL_H */
@@ -0,0 +1,73 @@
+#ifndef NFV_SOCKET_SHM_H
+#define NFV_SOCKET_SHM_H
+
+#include <stdbool.h>
+
+#include "nfv_socket.h"
+#include "shm.h"
+
+/* ---------------------------- TYPE DEFINITIONS ---------------------------- */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* -------------------- MACROS (FOR FUNCTION PROTOTYPES) -------------------- */
+
+#define NFV_SHM_SIGNATURE(return_t, name, ...)                                 \
+    NFV_SIGNATURE(return_t, shm_##name, ##__VA_ARGS__)
+
+/* ----------------------- CLASS FUNCTION PROTOTYPES ------------------------ */
+
+extern NFV_SHM_SIGNATURE(void, init, config_ptr conf);
+
+extern NFV_SHM_SIGNATURE(size_t, request_out_buffers, buffer_t buffers[],
+                         size_t howmany);
+
+extern NFV_SHM_SIGNATURE(ssize_t, send, size_t howmany);
+
+extern NFV_SHM_SIGNATURE(ssize_t, recv, buffer_t buffers[], size_t howmany);
+
+extern NFV_SHM_SIGNATURE(ssize_t, send_back, size_t howmany);
+
+/* ---------------------------- CLASS DEFINITION ---------------------------- */
+
+/**
+ * Exchanges payloads with another application on the same host through
+ * rings in shared memory, see shm.h. No kernel is involved on the data path.
+ *
+ * NOTICE: each direction admits a single producer and a single consumer, so
+ * at most one socket per application may send and one may receive.
+ * */
+struct nfv_socket_shm {
+    /* Base class holder */
+    struct nfv_socket super;
+
+    /* The shared region, shared with other loops of the same application */
+    struct shm_channel *chan;
+
+    /* Local copies of the ring indexes; the ones owned by the other
+     * application are refreshed only when needed */
+    uint32_t tx_head;
+    uint32_t tx_tail;
+    uint32_t rx_head;
+    uint32_t rx_tail;
+
+    /* Whether active buffers were received (or requested for sending) */
+    bool rx_owned;
+
+    /* RX descriptors taken by the last recv call, including discarded ones */
+    uint32_t rx_taken;
+
+    /* RX ring positions of the received packets */
+    uint32_t *rx_slots;
+
+    size_t active_buffers;
+    size_t used_buffers;
+};
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* NFV_SOCKET_SHM_H */
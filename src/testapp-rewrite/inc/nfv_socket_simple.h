@@ -3,6 +3,7 @@
 
 #include "hdr_tools.h"
 #include "nfv_socket.h"
+#include "packet_ring.h"
 
 #include <stdbool.h>
 
@@ -49,6 +50,8 @@ struct nfv_socket_simple {
     /* Header structures, used by raw sockets only */
     struct pkt_hdr outgoing_hdr;
     struct pkt_hdr incoming_hdr;
+    /* const */ uint16_t nb_ports; /* Number of local UDP ports packets may
+                                      be sent to, one per thread */
 
     /* Data structure used to hold the frame header, used by raw sockets only */
     byte_t frame_hdr[PKT_HEADER_SIZE];
@@ -64,6 +67,35 @@ struct nfv_socket_simple {
     struct iovec *iovecs;
     struct mmsghdr *datagrams;
 
+    /* PACKET_MMAP rings, if used packets point directly inside them */
+    struct packet_ring *ring;
+
+    /* UDP offloads, if used each burst is sent with few system calls and
+     * received as few coalesced buffers that are split in payloads */
+    /* const */ bool use_gso;
+    byte_t **gro_bufs; /* Circular array of coalesced receive buffers */
+    /* const */ size_t gro_bufs_count;
+    size_t gro_cur; /* The buffer currently being split */
+    size_t gro_len; /* The number of bytes received in gro_cur */
+    size_t gro_seg; /* The size of each datagram coalesced in gro_cur */
+    size_t gro_off; /* The offset of the next datagram in gro_cur */
+
+    /* MSG_ZEROCOPY transmissions, outgoing payloads are taken from a pool and
+     * reused only after the kernel notifies it is done with them */
+    /* const */ bool use_zerocopy;
+    bool zc_outgoing; /* Whether active buffers were taken from the pool */
+    /* const */ size_t zc_pool_size;
+    byte_t **zc_free; /* Circular FIFO of pool buffers ready to be used, so
+                         that buffers are reused in the same order */
+    size_t zc_free_head;
+    size_t zc_free_tail;
+    byte_t **zc_inflight; /* Circular FIFO of buffers given to the kernel */
+    uint32_t *zc_inflight_id; /* The notification id of each of them */
+    size_t zc_head;           /* The oldest buffer in zc_inflight */
+    size_t zc_tail;           /* The next free element of zc_inflight */
+    bool *zc_completed;       /* Completed notification ids, modulo pool size */
+    uint32_t zc_next_id;      /* The notification id of the next send */
+
     size_t active_buffers;
     size_t used_buffers;
 };
@@ -0,0 +1,88 @@
+#ifndef NFV_SOCKET_URING_H
+#define NFV_SOCKET_URING_H
+
+#include <stdbool.h>
+#include <sys/socket.h>
+
+#include "nfv_socket.h"
+#include "uring.h"
+
+/* ---------------------------- TYPE DEFINITIONS ---------------------------- */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* -------------------- MACROS (FOR FUNCTION PROTOTYPES) -------------------- */
+
+#define NFV_URING_SIGNATURE(return_t, name, ...)                               \
+    NFV_SIGNATURE(return_t, uring_##name, ##__VA_ARGS__)
+
+/* ----------------------- CLASS FUNCTION PROTOTYPES ------------------------ */
+
+extern NFV_URING_SIGNATURE(void, init, config_ptr conf);
+
+extern NFV_URING_SIGNATURE(size_t, request_out_buffers, buffer_t buffers[],
+                           size_t howmany);
+
+extern NFV_URING_SIGNATURE(ssize_t, send, size_t howmany);
+
+extern NFV_URING_SIGNATURE(ssize_t, recv, buffer_t buffers[], size_t howmany);
+
+extern NFV_URING_SIGNATURE(ssize_t, send_back, size_t howmany);
+
+/* ---------------------------- CLASS DEFINITION ---------------------------- */
+
+/**
+ * A connected UDP socket driven through io_uring.
+ *
+ * Outgoing payloads live in a registered memory area and are sent with one
+ * WRITE_FIXED operation each, submitted with a single system call per burst.
+ * Incoming payloads are received by a single multishot RECVMSG operation in
+ * buffers provided to the kernel through a buffer ring.
+ *
+ * Two different rings are used for transmission and reception, so that
+ * completions of either kind can be collected independently from each other.
+ * */
+struct nfv_socket_uring {
+    /* Base class holder */
+    struct nfv_socket super;
+
+    /* const */ int sock_fd;
+
+    struct uring tx_ring;
+    struct uring rx_ring;
+
+    /* Outgoing payloads, registered as fixed buffer URING_BUF_TX */
+    byte_t *tx_area;
+    /* const */ size_t tx_slot_size;
+    /* const */ uint32_t tx_slots;
+
+    /* Stack of slots not in use by either the application or the kernel */
+    uint32_t *tx_free;
+    uint32_t tx_free_count;
+
+    /* Incoming payloads, registered as fixed buffer URING_BUF_RX so that they
+     * can be sent back without copies */
+    byte_t *rx_area;
+    /* const */ size_t rx_slot_size;
+    struct uring_buf_ring rx_bufs;
+
+    /* Used by the multishot operation, which must be re-armed whenever the
+     * kernel terminates it */
+    struct msghdr rx_msg;
+    bool rx_armed;
+
+    /* Buffers currently owned by the application, each one either a TX slot
+     * or a RX buffer id, see URING_TAG_* */
+    uint64_t *buffers;
+
+    size_t active_buffers;
+    size_t used_buffers;
+};
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* NFV_SOCKET_URING_H */
@@ -0,0 +1,58 @@
+#ifndef NFV_SOCKET_XDP_H
+#define NFV_SOCKET_XDP_H
+
+#include "hdr_tools.h"
+#include "nfv_socket.h"
+#include "xdp.h"
+
+/* ---------------------------- TYPE DEFINITIONS ---------------------------- */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* -------------------- MACROS (FOR FUNCTION PROTOTYPES) -------------------- */
+
+#define NFV_XDP_SIGNATURE(return_t, name, ...)                                 \
+    NFV_SIGNATURE(return_t, xdp_##name, ##__VA_ARGS__)
+
+/* ----------------------- CLASS FUNCTION PROTOTYPES ------------------------ */
+
+extern NFV_XDP_SIGNATURE(void, init, config_ptr conf);
+
+extern NFV_XDP_SIGNATURE(size_t, request_out_buffers, buffer_t buffers[],
+                         size_t howmany);
+
+extern NFV_XDP_SIGNATURE(ssize_t, send, size_t howmany);
+
+extern NFV_XDP_SIGNATURE(ssize_t, recv, buffer_t buffers[], size_t howmany);
+
+extern NFV_XDP_SIGNATURE(ssize_t, send_back, size_t howmany);
+
+/* ---------------------------- CLASS DEFINITION ---------------------------- */
+
+struct nfv_socket_xdp {
+    /* Base class holder */
+    struct nfv_socket super;
+
+    /* Header of incoming packets, outgoing frames are prepared by xdp_init */
+    struct pkt_hdr incoming_hdr;
+
+    /* The AF_XDP socket, shared with other loops of the same application */
+    struct xdp_socket *xsk;
+
+    /* UMEM addresses of the frames to be sent/received */
+    uint64_t *frames;
+
+    /* Frames that shall be returned to the fill ring, used by recv */
+    uint64_t *recycled;
+
+    size_t active_buffers;
+    size_t used_buffers;
+};
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* NFV_SOCKET_XDP_H */
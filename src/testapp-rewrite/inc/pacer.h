@@ -0,0 +1,227 @@
+#ifndef PACER_H
+#define PACER_H
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <rte_branch_prediction.h>
+
+#include "config.h"
+#include "timestamp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------- Constants -------------------------------- */
+
+/* Late bursts sent back-to-back at most with PACER_CATCHUP_CAP */
+#define PACER_CAP_BURSTS 4
+
+/* Gaps precomputed for random profiles, a power of 2 */
+#define PACER_TABLE_BITS 12
+#define PACER_TABLE_SIZE (1UL << PACER_TABLE_BITS)
+
+/* Maximum duration of on and off phases [us] */
+#define PACER_MAX_PHASE_US 1000000
+
+/* ---------------------------- Type definitions ---------------------------- */
+
+/**
+ * Gaps between departures read from a file, converted to TSC cycles. Read-only
+ * after loading and shared by all threads.
+ * */
+struct pacer_trace {
+    size_t nb_deltas;
+    tsc_t *deltas;
+};
+
+/**
+ * The departure schedule of the packets of a single sending thread. Each
+ * departure is either a whole burst or, with spacing, a single packet.
+ *
+ * Constant gaps are kept as a number of TSC cycles plus a fraction of cycle,
+ * so that the long-run rate is exactly the configured one whatever the TSC
+ * frequency, instead of being rounded once per departure. Random gaps are
+ * drawn from a precomputed table, so that drawing one costs a few cycles.
+ * */
+struct pacer {
+    tsc_t tsc_next; /* Next departure time, integer part */
+    uint64_t frac;  /* Next departure time, fraction [1/gap_den] */
+
+    tsc_t gap;         /* Constant gap between departures, integer part */
+    uint64_t gap_frac; /* Constant gap between departures, fraction */
+    uint64_t gap_den;
+
+    enum pacer_profile profile;
+
+    tsc_t tsc_on;     /* Duration of on phases (on/off profile only) */
+    tsc_t tsc_off;    /* Duration of off phases (on/off profile only) */
+    tsc_t tsc_on_end; /* End of the current on phase (on/off profile only) */
+
+    const tsc_t *deltas; /* Gaps drawn by random and trace profiles */
+    tsc_t *table;        /* Gaps owned by the schedule (random profiles) */
+    size_t nb_deltas;
+    size_t next_delta; /* Next gap of the trace (trace profile only) */
+    uint64_t prng;     /* State of the xorshift generator */
+
+    size_t burst_size;
+    bool spacing;      /* Whether packets of a burst depart one by one */
+    tsc_t tsc_max_lag; /* Delay after which the catch-up policy applies */
+    enum pacer_catchup catchup;
+};
+
+/* -------------------------- Hot-path functions ---------------------------- */
+
+/**
+ * Draws a pseudo-random number (xorshift64*).
+ * */
+static inline uint64_t pacer_rand(struct pacer *pacer) {
+    uint64_t x = pacer->prng;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    pacer->prng = x;
+
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Moves an on/off schedule that was reset by the catch-up policy to the on
+ * phase its next departure falls in, or to the next one.
+ * */
+static inline void pacer_onoff_align(struct pacer *pacer) {
+    const tsc_t tsc_period = pacer->tsc_on + pacer->tsc_off;
+
+    if (likely(pacer->tsc_next < pacer->tsc_on_end))
+        return;
+
+    // Whole periods may have been skipped by the catch-up policy
+    pacer->tsc_on_end += (pacer->tsc_next - pacer->tsc_on_end) / tsc_period *
+                         tsc_period;
+
+    // Departures in the off phase are postponed to the next on phase
+    if (pacer->tsc_next < pacer->tsc_on_end + pacer->tsc_off) {
+        pacer->tsc_next = pacer->tsc_on_end + pacer->tsc_off;
+        pacer->frac = 0;
+    }
+
+    pacer->tsc_on_end += tsc_period;
+}
+
+/**
+ * Moves the schedule forward to the next departure.
+ * */
+static inline void pacer_advance(struct pacer *pacer) {
+    switch (pacer->profile) {
+    case PACER_PROFILE_POISSON:
+        pacer->tsc_next +=
+            pacer->deltas[pacer_rand(pacer) >> (64 - PACER_TABLE_BITS)];
+        return;
+    case PACER_PROFILE_TRACE:
+        pacer->tsc_next += pacer->deltas[pacer->next_delta];
+        if (++pacer->next_delta == pacer->nb_deltas)
+            pacer->next_delta = 0;
+        return;
+    default:
+        break;
+    }
+
+    pacer->tsc_next += pacer->gap;
+    pacer->frac += pacer->gap_frac;
+
+    if (pacer->frac >= pacer->gap_den) {
+        pacer->frac -= pacer->gap_den;
+        ++pacer->tsc_next;
+    }
+
+    // Departures falling in an off phase are postponed by its duration, so
+    // that the schedule of on phases is not rounded at their boundaries; gaps
+    // longer than an on phase cross many of them, each one adding an off one
+    if (pacer->profile == PACER_PROFILE_ONOFF &&
+        pacer->tsc_next >= pacer->tsc_on_end) {
+        const tsc_t crossed =
+            (pacer->tsc_next - pacer->tsc_on_end) / pacer->tsc_on + 1;
+
+        pacer->tsc_next += crossed * pacer->tsc_off;
+        pacer->tsc_on_end += crossed * (pacer->tsc_on + pacer->tsc_off);
+    }
+}
+
+/**
+ * Applies the catch-up policy to a schedule the thread is late on: late
+ * packets are either all sent back-to-back (burst), sent back-to-back up to
+ * PACER_CAP_BURSTS bursts (cap) or not sent at all (skip).
+ * */
+static inline void pacer_catch_up(struct pacer *pacer, tsc_t tsc_cur) {
+    if (likely(tsc_cur - pacer->tsc_next <= pacer->tsc_max_lag))
+        return;
+
+    switch (pacer->catchup) {
+    case PACER_CATCHUP_SKIP:
+        pacer->tsc_next = tsc_cur;
+        break;
+    case PACER_CATCHUP_CAP:
+        pacer->tsc_next = tsc_cur - pacer->tsc_max_lag;
+        break;
+    default:
+        return;
+    }
+
+    pacer->frac = 0;
+
+    if (pacer->profile == PACER_PROFILE_ONOFF)
+        pacer_onoff_align(pacer);
+}
+
+/**
+ * Returns how many packets (at most a burst) shall be sent at the given time
+ * and moves the schedule forward accordingly.
+ *
+ * A whole burst is sent as soon as it is due, unless spacing is enabled, in
+ * which case only the packets already due are.
+ * */
+static inline size_t pacer_due(struct pacer *pacer, tsc_t tsc_cur) {
+    size_t howmany = 0;
+
+    if (tsc_cur < pacer->tsc_next)
+        return 0;
+
+    pacer_catch_up(pacer, tsc_cur);
+
+    // Catching up may have postponed the departure to the next on phase
+    if (unlikely(tsc_cur < pacer->tsc_next))
+        return 0;
+
+    if (!pacer->spacing) {
+        pacer_advance(pacer);
+        return pacer->burst_size;
+    }
+
+    do {
+        pacer_advance(pacer);
+        ++howmany;
+    } while (howmany < pacer->burst_size && pacer->tsc_next <= tsc_cur);
+
+    return howmany;
+}
+
+/* -------------------------------- FUNCTIONS --------------------------------*/
+
+extern int pacer_trace_init(struct config *conf);
+
+extern void pacer_init(struct pacer *pacer, const struct config *conf,
+                       tsc_t tsc_start);
+
+extern void pacer_set_rate(struct pacer *pacer, const struct config *conf,
+                           rate_t rate, tsc_t tsc_start);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // PACER_H
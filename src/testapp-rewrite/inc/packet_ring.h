@@ -0,0 +1,103 @@
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <stdint.h>
+
+#include <linux/if_packet.h>
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------- Constants -------------------------------- */
+
+/* NOTICE: frames must be big enough to hold MAX_PKT_SIZE bytes plus the
+ * TPACKET_V3 header and the sockaddr_ll structure that precede the frame. */
+#define PACKET_RING_FRAME_SIZE 2048
+#define PACKET_RING_BLOCK_SIZE (1 << 18)
+#define PACKET_RING_RX_BLOCKS 64
+#define PACKET_RING_TX_BLOCKS 16
+
+/* Blocks are handed to the application after this timeout even when not full
+ * [ms], this bounds the additional latency of block-based reception */
+#define PACKET_RING_RX_TIMEOUT 1
+
+/* Offset of frame data within each TX frame (no PACKET_TX_HAS_OFF) */
+#define PACKET_RING_TX_DATA_OFFSET                                             \
+    (TPACKET3_HDRLEN - sizeof(struct sockaddr_ll))
+
+/* ---------------------------- Type definitions ---------------------------- */
+
+/**
+ * A pair of PACKET_MMAP rings mapped on the same raw socket.
+ *
+ * The RX ring is block-based (TPACKET_V3), while the TX ring is frame-based.
+ * Reception state is touched only by the receiving thread, transmission state
+ * only by the sending thread.
+ * */
+struct packet_ring {
+    byte_t *map;
+    size_t map_size;
+
+    struct tpacket_req3 rx_req;
+    byte_t *rx_area;
+    uint32_t rx_block;            /* The block currently being consumed */
+    uint32_t rx_pkt;              /* Packets already consumed from rx_block */
+    struct tpacket3_hdr *rx_next; /* The next packet to consume in rx_block */
+
+    struct tpacket_req3 tx_req;
+    byte_t *tx_area;
+    uint32_t tx_frame; /* The next frame to be sent */
+};
+
+/* ---------------------------- Ring operations ----------------------------- */
+
+static inline struct tpacket_block_desc *
+packet_ring_rx_block(struct packet_ring *r, uint32_t idx) {
+    return (struct tpacket_block_desc *)(r->rx_area +
+                                         idx * r->rx_req.tp_block_size);
+}
+
+static inline bool packet_ring_rx_block_ready(struct tpacket_block_desc *b) {
+    return (__atomic_load_n(&b->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+            TP_STATUS_USER) != 0;
+}
+
+static inline void packet_ring_rx_block_release(struct tpacket_block_desc *b) {
+    __atomic_store_n(&b->hdr.bh1.block_status, TP_STATUS_KERNEL,
+                     __ATOMIC_RELEASE);
+}
+
+static inline struct tpacket3_hdr *packet_ring_tx_frame(struct packet_ring *r,
+                                                        uint32_t idx) {
+    idx %= r->tx_req.tp_frame_nr;
+    return (struct tpacket3_hdr *)(r->tx_area + idx * r->tx_req.tp_frame_size);
+}
+
+static inline byte_t *packet_ring_tx_data(struct tpacket3_hdr *frame) {
+    return (byte_t *)frame + PACKET_RING_TX_DATA_OFFSET;
+}
+
+static inline bool packet_ring_tx_frame_available(struct tpacket3_hdr *frame) {
+    return (__atomic_load_n(&frame->tp_status, __ATOMIC_ACQUIRE) &
+            (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING)) == 0;
+}
+
+static inline void packet_ring_tx_frame_submit(struct tpacket3_hdr *frame,
+                                               uint32_t len) {
+    frame->tp_len = len;
+    frame->tp_snaplen = len;
+    frame->tp_next_offset = 0;
+    __atomic_store_n(&frame->tp_status, TP_STATUS_SEND_REQUEST,
+                     __ATOMIC_RELEASE);
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // PACKET_RING_H
@@ -0,0 +1,47 @@
+#ifndef PCAP_H
+#define PCAP_H
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------- Constants -------------------------------- */
+
+#define PCAP_MAGIC_USEC 0xa1b2c3d4 /* Timestamps are in microseconds */
+#define PCAP_MAGIC_NSEC 0xa1b23c4d /* Timestamps are in nanoseconds */
+#define PCAP_VERSION_MAJOR 2
+#define PCAP_VERSION_MINOR 4
+#define PCAP_LINKTYPE_ETHERNET 1
+
+/* ---------------------------- Type definitions ---------------------------- */
+
+/**
+ * Headers of the classic pcap file format, whose fields are in the byte order
+ * of the host that wrote the file (see the magic number).
+ * */
+struct pcap_file_hdr {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+};
+
+struct pcap_rec_hdr {
+    uint32_t ts_sec;
+    uint32_t ts_nsec; /* Microseconds, depending on the magic number */
+    uint32_t caplen;
+    uint32_t len;
+};
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // PCAP_H
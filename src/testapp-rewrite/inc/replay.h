@@ -0,0 +1,107 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <rte_memcpy.h>
+
+#include "config.h"
+#include "nfv_socket.h"
+#include "timestamp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ---------------------------- Type definitions ---------------------------- */
+
+/**
+ * The payloads of a pcap file, preloaded in memory, each one truncated or
+ * padded with zeros to the payload size of the application, along with their
+ * original departure times.
+ *
+ * The whole trace is read-only after loading and shared by all threads.
+ * */
+struct replay {
+    size_t nb_pkts;
+    size_t payload_size;
+
+    byte_t *payloads;    /* nb_pkts consecutive payloads */
+    tsc_t *tsc_offsets;  /* Departure of each packet from the first one */
+    tsc_t tsc_period;    /* Duration of a whole pass over the trace */
+
+    size_t area_size;
+    bool area_dpdk; /* Whether payloads were allocated by DPDK */
+};
+
+/**
+ * The position of a single thread in the trace.
+ * */
+struct replay_cursor {
+    size_t next;     /* Index of the next packet to be sent */
+    tsc_t tsc_start; /* Departure time of the first packet of this pass */
+};
+
+/* -------------------------- Hot-path functions ---------------------------- */
+
+static inline void replay_cursor_init(struct replay_cursor *cursor,
+                                      tsc_t tsc_start) {
+    cursor->next = 0;
+    cursor->tsc_start = tsc_start;
+}
+
+/**
+ * Returns how many packets (at most max) should have already departed at
+ * the given time, following the original timing of the trace.
+ * */
+static inline size_t replay_due(const struct replay *replay,
+                                const struct replay_cursor *cursor,
+                                tsc_t tsc_cur, size_t max) {
+    size_t next = cursor->next;
+    tsc_t tsc_start = cursor->tsc_start;
+    size_t howmany = 0;
+
+    while (howmany < max &&
+           tsc_start + replay->tsc_offsets[next] <= tsc_cur) {
+        ++howmany;
+        if (++next == replay->nb_pkts) {
+            next = 0;
+            tsc_start += replay->tsc_period;
+        }
+    }
+
+    return howmany;
+}
+
+/**
+ * Copies the next howmany payloads of the trace in the given buffers and
+ * advances the cursor, wrapping around at the end of the trace.
+ * */
+static inline void replay_fill(const struct replay *replay,
+                               struct replay_cursor *cursor,
+                               buffer_t buffers[], size_t howmany) {
+    for (size_t i = 0; i < howmany; ++i) {
+        rte_memcpy(buffers[i],
+                   replay->payloads + cursor->next * replay->payload_size,
+                   replay->payload_size);
+
+        if (++cursor->next == replay->nb_pkts) {
+            cursor->next = 0;
+            cursor->tsc_start += replay->tsc_period;
+        }
+    }
+}
+
+/* -------------------------------- FUNCTIONS --------------------------------*/
+
+extern int replay_init(struct config *conf);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // REPLAY_H
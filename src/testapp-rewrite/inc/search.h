@@ -0,0 +1,144 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <netinet/in.h>
+
+#include <rte_branch_prediction.h>
+#include <rte_memory.h>
+
+#include "config.h"
+#include "constants.h"
+#include "histogram.h"
+#include "timestamp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ---------------------------- Type definitions ---------------------------- */
+
+/**
+ * The packets counted by a single thread taking part in the search.
+ * */
+struct search_slot {
+    uint64_t count; /* Packets sent or received so far, written by the owner
+                       thread only */
+    uint64_t epoch; /* Last trial state applied by the owner thread (polling
+                       threads only) */
+    struct histogram *delays; /* Round-trip delays of the current trial,
+                                 written by the owner thread until the trial
+                                 stops recording them, read by the controller
+                                 only after that (receiving slots of latency
+                                 searches only) */
+} __rte_cache_aligned;
+
+/**
+ * The state of a rate search, shared by the threads counting packets and the
+ * one running the trials.
+ *
+ * In a loss search the sending application drives the search: it runs trials
+ * at different rates and asks the receiving application how many packets it
+ * received during each trial, over a TCP control channel. In a latency search
+ * the client drives it alone, measuring round-trip delays by itself.
+ * */
+struct search {
+    uint64_t epoch __rte_cache_aligned; /* Incremented on each rate change */
+    rate_t rate; /* Per-thread rate of the current trial, 0 while paused */
+    tsc_t tsc_start; /* Start of the current trial: replies to packets sent
+                        before it are not recorded (latency search only) */
+    bool record; /* Whether client threads record delays, from the start of a
+                    trial to the end of its drain time (latency search only) */
+
+    bool controller __rte_cache_aligned; /* Whether this side drives the
+                                            search, i.e. sends packets */
+    bool latency; /* Whether trials are judged by delays, in which case the
+                     receiving slots are polled too */
+    bool senders; /* Whether sending slots are polled, i.e. some threads
+                     only send */
+    struct sockaddr_in addr; /* Control channel address of the receiver */
+    int fd;
+
+    unsigned int nb_slots;
+    struct search_slot tx[MAX_THREADS];
+    struct search_slot rx[MAX_THREADS];
+};
+
+/* -------------------------- Hot-path functions ---------------------------- */
+
+/**
+ * Adds howmany packets to the ones counted by the given slot.
+ * */
+static inline void search_count(struct search_slot *slot, uint64_t howmany) {
+    __atomic_store_n(&slot->count, slot->count + howmany, __ATOMIC_RELAXED);
+}
+
+/**
+ * Tells whether the rate of the search changed since the last call, and
+ * returns the new one in rate (0 if sending shall be paused).
+ *
+ * The change is acknowledged to the controller right away: the caller shall
+ * not send any more packets at the old rate after this call.
+ * */
+static inline bool search_poll(const struct search *search,
+                               struct search_slot *slot, rate_t *rate) {
+    uint64_t epoch = __atomic_load_n(&search->epoch, __ATOMIC_ACQUIRE);
+
+    if (likely(epoch == slot->epoch))
+        return false;
+
+    *rate = search->rate;
+    __atomic_store_n(&slot->epoch, epoch, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/**
+ * Like search_poll(), for the client threads of latency searches: also tells
+ * whether the delays of the trial shall be recorded in the given slot and
+ * returns its start in tsc_start, resetting the delays when a new trial
+ * starts.
+ *
+ * All of it happens before the change is acknowledged, since the delays of
+ * the slot are read by the controller right after it stops recording them.
+ * */
+static inline bool search_poll_delays(const struct search *search,
+                                      struct search_slot *slot, rate_t *rate,
+                                      bool *record, tsc_t *tsc_start) {
+    uint64_t epoch = __atomic_load_n(&search->epoch, __ATOMIC_ACQUIRE);
+
+    if (likely(epoch == slot->epoch))
+        return false;
+
+    *rate = search->rate;
+    *record = search->record;
+
+    if (*rate != 0) {
+        *tsc_start = search->tsc_start;
+        histogram_reset(slot->delays);
+    }
+
+    __atomic_store_n(&slot->epoch, epoch, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/* -------------------------------- FUNCTIONS --------------------------------*/
+
+extern int search_init(struct config *conf, bool senders, bool clients);
+
+extern struct search_slot *search_tx_attach(struct config *conf);
+
+extern struct search_slot *search_rx_attach(struct config *conf);
+
+extern void search_run(struct config *conf) __attribute__((noreturn));
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // SEARCH_H
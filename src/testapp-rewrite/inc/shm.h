@@ -0,0 +1,88 @@
+#ifndef SHM_H
+#define SHM_H
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <stdint.h>
+
+#include <rte_memory.h>
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------- Constants -------------------------------- */
+
+#define SHM_MAGIC 0x4e465653 /* "NFVS" */
+#define SHM_VERSION 1
+
+#define SHM_RING_SIZE 1024 /* Number of descriptors in each ring */
+#define SHM_BUF_SIZE 2048  /* Size of each buffer [bytes] */
+#define SHM_NUM_BUFS (2 * SHM_RING_SIZE)
+
+/* The shared file is sized as a multiple of this, as required by hugetlbfs */
+#define SHM_HUGEPAGE_SIZE (2UL << 20)
+
+/* ---------------------------- Type definitions ---------------------------- */
+
+struct shm_desc {
+    uint32_t buf; /* Index of the buffer in the shared pool */
+    uint32_t len; /* Length of the payload in the buffer [bytes] */
+};
+
+/**
+ * A single-producer/single-consumer descriptor ring, one per direction.
+ *
+ * Each buffer of the pool is referenced by exactly one descriptor of either
+ * ring. Descriptors between tail and head belong to the consumer, all the
+ * others to the producer; hence releasing a descriptor by moving the tail
+ * gives its buffer back to the producer (memif-style). The consumer may swap
+ * the buffer of a descriptor it owns with one it owns in the other ring
+ * before releasing it, which lets packets be sent back without copies.
+ * */
+struct shm_ring {
+    uint32_t head __rte_cache_aligned; /* Written by the producer only */
+    uint32_t tail __rte_cache_aligned; /* Written by the consumer only */
+    struct shm_desc desc[SHM_RING_SIZE] __rte_cache_aligned;
+};
+
+/**
+ * The layout of the file shared by the two applications.
+ * */
+struct shm_region {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ring_size;
+    uint32_t buf_size;
+
+    struct shm_ring rings[2];
+
+    byte_t bufs[SHM_NUM_BUFS][SHM_BUF_SIZE] __rte_cache_aligned;
+};
+
+/**
+ * The view that one application has of the shared region.
+ * */
+struct shm_channel {
+    int fd;
+    struct shm_region *region;
+    size_t map_size;
+    struct shm_ring *tx; /* The ring this application produces on */
+    struct shm_ring *rx; /* The ring this application consumes from */
+};
+
+/* -------------------------------- FUNCTIONS --------------------------------*/
+
+static inline byte_t *shm_buf(struct shm_channel *chan, uint32_t buf) {
+    return chan->region->bufs[buf];
+}
+
+extern int shm_init(struct config *conf);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // SHM_H
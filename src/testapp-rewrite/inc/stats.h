@@ -8,15 +8,22 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "histogram.h"
 #include "timestamp.h"
 #include <rte_memory.h>
 
-/* ******************** STRUCTS ******************** */
-
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* ******************** CONSTANTS ******************** */
+
+/* Number of percentiles of delays reported by delay stats, see
+ * stats_percentiles */
+#define STATS_PERCENTILES 5
+
+/* ******************** STRUCTS ******************** */
+
 struct stats_data_tx {
     uint64_t tx;
     uint64_t dropped;
@@ -26,9 +33,16 @@ struct stats_data_rx {
     uint64_t rx;
 } __rte_cache_aligned;
 
+/* Summary of the delays measured in a period, in TSC cycles; these are below
+ * tsc_hz / 10 (later replies are outliers, see client_loop), so 32 bits are
+ * enough and the summary fits in a cache line like other stats */
 struct stats_data_delay {
-    uint64_t avg;
-    uint64_t num;
+    uint64_t num;      /* Delays measured */
+    uint64_t outliers; /* Replies so late that their delay is not measured */
+    uint32_t avg;
+    uint32_t min;
+    uint32_t max;
+    uint32_t percentiles[STATS_PERCENTILES];
 } __rte_cache_aligned;
 
 union stats_data {
@@ -49,10 +63,18 @@ struct stats {
     uint8_t last;
     uint8_t count;
     union stats_data data[64];
+
+    // Delay stats only: all delays measured so far, not just the ones of the
+    // saved periods
+    struct histogram delays;
+    uint64_t outliers;
 };
 
 /* **************** INLINE FUNCTIONS **************** */
 
+extern void stats_print_delay(const char *label,
+                              const struct stats_data_delay *d);
+
 static inline void stats_print(enum stats_type t, union stats_data *d) {
     switch (t) {
     case STATS_TX:
@@ -63,9 +85,7 @@ static inline void stats_print(enum stats_type t, union stats_data *d) {
         printf("Rx-pps: %lu\n", d->r.rx);
         return;
     case STATS_DELAY:
-        printf("Avg delay (us) and rx count: %f %lu\n",
-               ((double)d->d.avg) / ((double)tsc_get_hz()) * 1000000.,
-               d->d.num);
+        stats_print_delay("Delay", &d->d);
         return;
     }
 }
@@ -74,12 +94,19 @@ static inline void stats_print(enum stats_type t, union stats_data *d) {
 
 extern void stats_save(struct stats *s, union stats_data *d);
 
+extern void stats_save_delay(struct stats *s, struct stats_data_delay *d,
+                             const struct histogram *h);
+
 extern void stats_print_all(struct stats *s);
 
+extern void stats_merge(struct stats *dst, const struct stats *src);
+
 /* ******************** CONSTANTS ******************** */
 
 extern const struct stats STATS_INIT;
 
+extern const double stats_percentiles[STATS_PERCENTILES];
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,169 @@
+#ifndef URING_H
+#define URING_H
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ---------------------------- Type definitions ---------------------------- */
+
+/**
+ * An io_uring instance, with both submission and completion queues mapped in
+ * the application address space.
+ *
+ * NOTICE: each instance shall be used by one thread only.
+ * */
+struct uring {
+    int fd;
+    uint32_t flags; /* The flags the ring was actually set up with */
+
+    /* Submission queue */
+    uint32_t *sq_head;
+    uint32_t *sq_tail;
+    uint32_t *sq_flags;
+    uint32_t sq_mask;
+    uint32_t sq_entries;
+    uint32_t sqe_tail;      /* The next SQE to be handed to the application */
+    uint32_t sqe_submitted; /* The SQEs already handed to the kernel */
+    struct io_uring_sqe *sqes;
+
+    /* Completion queue */
+    uint32_t *cq_head;
+    uint32_t *cq_tail;
+    uint32_t cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_map;
+    size_t sq_map_size;
+    void *cq_map;
+    size_t cq_map_size;
+};
+
+/**
+ * A ring of buffers provided to the kernel, which picks one of them for each
+ * incoming packet (IOSQE_BUFFER_SELECT).
+ * */
+struct uring_buf_ring {
+    struct io_uring_buf_ring *br;
+    uint16_t bgid;
+    uint16_t tail;
+    uint16_t mask;
+    uint32_t entries;
+};
+
+/* ------------------------ Submission queue helpers ------------------------ */
+
+/**
+ * Returns a cleared SQE to be filled by the application, NULL if the
+ * submission queue is full.
+ * */
+static inline struct io_uring_sqe *uring_get_sqe(struct uring *r) {
+    uint32_t head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    struct io_uring_sqe *sqe;
+
+    if (r->sqe_tail - head >= r->sq_entries)
+        return NULL;
+
+    sqe = &r->sqes[r->sqe_tail & r->sq_mask];
+    ++r->sqe_tail;
+
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+/**
+ * Makes all the SQEs obtained with uring_get_sqe visible to the kernel.
+ *
+ * \return the number of new SQEs.
+ * */
+static inline uint32_t uring_flush_sq(struct uring *r) {
+    uint32_t to_submit = r->sqe_tail - r->sqe_submitted;
+
+    if (to_submit)
+        __atomic_store_n(r->sq_tail, r->sqe_tail, __ATOMIC_RELEASE);
+
+    r->sqe_submitted = r->sqe_tail;
+    return to_submit;
+}
+
+/**
+ * Tells whether the kernel has some pending work for this ring, whose
+ * completions will not show up until the application enters the kernel.
+ * */
+static inline bool uring_needs_enter(struct uring *r) {
+    return (__atomic_load_n(r->sq_flags, __ATOMIC_RELAXED) &
+            IORING_SQ_TASKRUN) != 0;
+}
+
+/* ------------------------ Completion queue helpers ------------------------ */
+
+/**
+ * Returns the number of completions that are ready, head is set to the first
+ * one.
+ * */
+static inline uint32_t uring_cq_ready(struct uring *r, uint32_t *head) {
+    *head = *r->cq_head;
+    return __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE) - *head;
+}
+
+static inline struct io_uring_cqe *uring_cqe_at(struct uring *r,
+                                                uint32_t idx) {
+    return &r->cqes[idx & r->cq_mask];
+}
+
+static inline void uring_cq_advance(struct uring *r, uint32_t nb) {
+    __atomic_store_n(r->cq_head, *r->cq_head + nb, __ATOMIC_RELEASE);
+}
+
+/* ------------------------- Provided buffer helpers ------------------------ */
+
+/**
+ * Adds a buffer to the ring; buffers become visible to the kernel only after
+ * uring_buf_ring_advance.
+ * */
+static inline void uring_buf_ring_add(struct uring_buf_ring *b, void *addr,
+                                      uint32_t len, uint16_t bid,
+                                      uint16_t offset) {
+    struct io_uring_buf *buf = &b->br->bufs[(b->tail + offset) & b->mask];
+
+    buf->addr = (uint64_t)(uintptr_t)addr;
+    buf->len = len;
+    buf->bid = bid;
+}
+
+static inline void uring_buf_ring_advance(struct uring_buf_ring *b,
+                                          uint16_t nb) {
+    b->tail += nb;
+    __atomic_store_n(&b->br->tail, b->tail, __ATOMIC_RELEASE);
+}
+
+/* -------------------------------- FUNCTIONS --------------------------------*/
+
+extern int uring_init(struct uring *r, uint32_t entries);
+
+extern int uring_enter(struct uring *r, uint32_t to_submit,
+                       uint32_t min_complete, uint32_t flags);
+
+extern int uring_submit(struct uring *r);
+
+extern int uring_register_buffers(struct uring *r, const struct iovec *iovs,
+                                  uint32_t howmany);
+
+extern int uring_buf_ring_init(struct uring *r, struct uring_buf_ring *b,
+                               uint32_t entries, uint16_t bgid);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // URING_H
@@ -0,0 +1,163 @@
+#ifndef XDP_MINE_H
+#define XDP_MINE_H
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <stdint.h>
+
+#include <linux/if_xdp.h>
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------- Constants -------------------------------- */
+
+#define XDP_FRAME_SIZE 2048 /* Size of each UMEM frame [bytes] */
+#define XDP_NUM_FRAMES 4096 /* Number of frames in the UMEM area */
+#define XDP_RING_SIZE 2048  /* Number of descriptors in each ring */
+
+#define XDP_RX_FRAMES (XDP_NUM_FRAMES / 2) /* Frames used for reception */
+
+/* ---------------------------- Type definitions ---------------------------- */
+
+/**
+ * A single-producer/single-consumer ring shared with the kernel.
+ *
+ * The producer side caches the consumer index (and vice-versa) to avoid
+ * touching the shared cache line on each operation.
+ * */
+struct xdp_ring {
+    uint32_t cached_prod;
+    uint32_t cached_cons;
+    uint32_t mask;
+    uint32_t size;
+    uint32_t *producer;
+    uint32_t *consumer;
+    uint32_t *flags;
+    void *ring;
+    void *map; /* Start of the mapping, to unmap it */
+    size_t map_len;
+};
+
+/**
+ * An AF_XDP socket with its own UMEM area.
+ *
+ * The first half of the UMEM frames is handed to the kernel through the fill
+ * ring and is used for incoming packets only, while the second half is used
+ * for outgoing packets. Received frames that are sent back are returned to the
+ * fill ring when their completion arrives.
+ *
+ * NOTICE: rings are single-producer/single-consumer, thus at most one thread
+ * may receive and at most one thread may send using the same socket.
+ * */
+struct xdp_socket {
+    int fd;      /* The AF_XDP socket file descriptor */
+    int map_fd;  /* The XSKMAP used by the XDP program to redirect frames */
+    int prog_fd; /* The XDP program redirecting frames to this socket */
+    int link_fd; /* The link that keeps the XDP program attached */
+
+    bool zerocopy;    /* Whether the driver accepted zero-copy mode */
+    bool need_wakeup; /* Whether the kernel must be woken up explicitly */
+
+    byte_t *umem_area;
+    size_t umem_size;
+
+    struct xdp_ring fill;
+    struct xdp_ring comp;
+    struct xdp_ring rx;
+    struct xdp_ring tx;
+
+    /* Stack of free frames for outgoing packets (sender thread only) */
+    uint64_t *tx_frames;
+    uint32_t tx_frames_count;
+};
+
+/* ---------------------------- Ring operations ----------------------------- */
+
+static inline uint64_t *xdp_ring_addr(struct xdp_ring *r, uint32_t idx) {
+    return &((uint64_t *)r->ring)[idx & r->mask];
+}
+
+static inline struct xdp_desc *xdp_ring_desc(struct xdp_ring *r,
+                                             uint32_t idx) {
+    return &((struct xdp_desc *)r->ring)[idx & r->mask];
+}
+
+/**
+ * Reserves up to nb slots in a ring the application produces to.
+ *
+ * \return the number of slots reserved, idx is set to the first one.
+ * */
+static inline uint32_t xdp_ring_reserve(struct xdp_ring *r, uint32_t nb,
+                                        uint32_t *idx) {
+    uint32_t free_entries = r->cached_cons - r->cached_prod;
+
+    if (free_entries < nb) {
+        r->cached_cons =
+            __atomic_load_n(r->consumer, __ATOMIC_ACQUIRE) + r->size;
+        free_entries = r->cached_cons - r->cached_prod;
+        if (free_entries < nb)
+            nb = free_entries;
+    }
+
+    *idx = r->cached_prod;
+    r->cached_prod += nb;
+    return nb;
+}
+
+static inline void xdp_ring_submit(struct xdp_ring *r, uint32_t nb) {
+    __atomic_store_n(r->producer, *r->producer + nb, __ATOMIC_RELEASE);
+}
+
+/**
+ * Peeks up to nb entries from a ring the application consumes from.
+ *
+ * \return the number of entries available, idx is set to the first one.
+ * */
+static inline uint32_t xdp_ring_peek(struct xdp_ring *r, uint32_t nb,
+                                     uint32_t *idx) {
+    uint32_t entries = r->cached_prod - r->cached_cons;
+
+    if (entries == 0) {
+        r->cached_prod = __atomic_load_n(r->producer, __ATOMIC_ACQUIRE);
+        entries = r->cached_prod - r->cached_cons;
+    }
+
+    if (entries > nb)
+        entries = nb;
+
+    *idx = r->cached_cons;
+    r->cached_cons += entries;
+    return entries;
+}
+
+static inline void xdp_ring_release(struct xdp_ring *r, uint32_t nb) {
+    __atomic_store_n(r->consumer, *r->consumer + nb, __ATOMIC_RELEASE);
+}
+
+static inline bool xdp_ring_needs_wakeup(struct xdp_ring *r) {
+    return (*r->flags & XDP_RING_NEED_WAKEUP) != 0;
+}
+
+/**
+ * Tells whether the given UMEM address belongs to a reception frame (which
+ * shall be returned to the fill ring) or to a transmission one.
+ * */
+static inline bool xdp_is_rx_frame(uint64_t addr) {
+    return addr < (uint64_t)XDP_RX_FRAMES * XDP_FRAME_SIZE;
+}
+
+/* -------------------------------- FUNCTIONS --------------------------------*/
+
+extern int xdp_init(struct config *conf);
+
+extern void xdp_close(struct config *conf);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // XDP_MINE_H
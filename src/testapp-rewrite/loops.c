@@ -6,11 +6,16 @@
 
 #include <signal.h>
 #include <stdbool.h>
+#include <unistd.h>
 
+#include "capture.h"
 #include "config.h"
 #include "loops.h"
 #include "nfv_socket.h"
+#include "pacer.h"
 #include "payload_util.h"
+#include "replay.h"
+#include "search.h"
 #include "stats.h"
 #include "timestamp.h"
 
@@ -28,7 +33,12 @@ typedef struct nfv_socket *nfv_socket_ptr;
 
 /* -------------------------------- GLOBALS --------------------------------- */
 
-struct stats *stats_ptr = NULL;
+/* Stats of each thread running the same loop, indexed by side (the peer one
+ * is used only by loopback tests) and thread_id */
+struct stats *stats_ptrs[2][MAX_THREADS] = {{NULL}};
+
+/* Capture file written by capture_loop, if any */
+struct capture *capture_ptr = NULL;
 
 /* --------------------------- UTILITY  FUNCTIONS --------------------------- */
 
@@ -38,14 +48,28 @@ void handle_sigint(int sig) {
     printf("\nCaught signal %s!\n", strsignal(sig));
 
     if (sig == SIGINT) {
-        if (stats_ptr != NULL) {
+        for (int side = 0; side < 2; ++side) {
+            if (stats_ptrs[side][0] == NULL)
+                continue;
+
+            // Stats of all threads are printed as a whole
+            struct stats total = *stats_ptrs[side][0];
+
+            for (int i = 1; i < MAX_THREADS; ++i) {
+                if (stats_ptrs[side][i] != NULL)
+                    stats_merge(&total, stats_ptrs[side][i]);
+            }
+
             // Print average stats
             printf("-------------------------------------\n");
-            printf("FINAL STATS\n");
+            printf(side ? "FINAL STATS (LOOPBACK PEER)\n" : "FINAL STATS\n");
 
-            stats_print_all(stats_ptr);
+            stats_print_all(&total);
         }
 
+        if (capture_ptr != NULL)
+            capture_close(capture_ptr);
+
         exit(EXIT_SUCCESS);
     }
 }
@@ -85,15 +109,12 @@ static inline void stats_save_reset_rx(struct stats *stats,
 
 static inline void stats_save_reset_delay(struct stats *stats,
                                           struct stats_data_delay *stats_period,
+                                          struct histogram *delays,
                                           struct config *conf) {
     // If there is some stat to actually save
-    if (stats_period->num) {
-        // Calculate the actual average (until now it is a total,
-        // despite the name)
-        stats_period->avg = stats_period->avg / stats_period->num;
-
-        // Save stats
-        stats_save(stats, (union stats_data *)stats_period);
+    if (delays->total || stats_period->outliers) {
+        // Save stats, summarizing the delays of the period
+        stats_save_delay(stats, stats_period, delays);
 
         // If not conf->silent, print them
         if (!conf->silent) {
@@ -102,18 +123,27 @@ static inline void stats_save_reset_delay(struct stats *stats,
     }
 
     // Reset stats for the new period
-    stats_period->avg = 0;
-    stats_period->num = 0;
+    histogram_reset(delays);
+    stats_period->outliers = 0;
 }
 
 static inline ssize_t prepare_send_burst(struct config *conf,
                                          nfv_socket_ptr socket,
                                          buffer_t buffers[],
-                                         size_t burst_size) {
+                                         size_t burst_size,
+                                         struct replay_cursor *cursor) {
     tsc_t tsc_cur;
     size_t howmany =
         nfv_socket_request_out_buffers(socket, buffers, burst_size);
 
+    // Replayed payloads keep the timestamp in their first bytes too
+    if (conf->replay.replay != NULL)
+        replay_fill(conf->replay.replay, cursor, buffers, howmany);
+
+    // Static packets are sent as they are
+    if (conf->dpdk.static_payloads)
+        return nfv_socket_send(socket, howmany);
+
     // Put payload data in each packet
     for (size_t i = 0; i < howmany; ++i) {
         // The first element will have the current value of the tsc,
@@ -184,7 +214,6 @@ int send_loop(void *arg) {
     /* ----------------------------- Constants ------------------------------ */
     const tsc_t tsc_hz = tsc_get_hz();
     const tsc_t tsc_out = tsc_hz;
-    const tsc_t tsc_incr = tsc_hz * conf->bst_size / conf->rate;
 
     // TODO: more constants derived from conf
     const bool should_save_stats =
@@ -192,20 +221,34 @@ int send_loop(void *arg) {
 
     const bool should_read_tsc = !(strstr(conf->cmdname, "client") != NULL);
 
+    const struct replay *replay = conf->replay.replay;
+    const bool replay_timing = replay != NULL && conf->replay.timing;
+
     /* ------------------- Variables and data structures -------------------- */
 
     // Pointer to payload buffers
     buffer_t buffers[conf->bst_size];
 
     // Timers and counters
-    tsc_t tsc_cur, tsc_prev, tsc_next;
+    tsc_t tsc_cur, tsc_prev;
+
+    // Departure schedule of packets
+    struct pacer pacer;
+
+    // Position in the replayed trace (if any)
+    struct replay_cursor cursor;
+
+    // Counters of the rate search (if any), which starts paused
+    struct search_slot *search = search_tx_attach(conf);
+    bool paused = search != NULL;
+    rate_t rate;
 
     // Stats variables
     struct stats stats = STATS_INIT;
 
     stats.type = STATS_TX;
     if (should_save_stats) // FIXME:
-        stats_ptr = &stats;
+        stats_ptrs[conf->is_peer][conf->thread_id] = &stats;
 
     struct stats_data_tx stats_period = {0, 0};
 
@@ -214,13 +257,17 @@ int send_loop(void *arg) {
     /* ------------------ Infinite loop variables and body ------------------ */
 
     if (should_read_tsc)
-        tsc_prev = tsc_cur = tsc_next = tsc_read();
+        tsc_prev = tsc_cur = tsc_read();
     else {
         do {
-            tsc_prev = tsc_cur = tsc_next = tsc_get_last();
+            tsc_prev = tsc_cur = tsc_get_last();
         } while (tsc_cur == 0);
     }
 
+    pacer_init(&pacer, conf, tsc_cur);
+    replay_cursor_init(&cursor, tsc_cur);
+
+    size_t howmany;
     ssize_t num_sent;
 
     for (ever) {
@@ -238,12 +285,26 @@ int send_loop(void *arg) {
             tsc_prev = tsc_cur;
         }
 
-        //  If it is already time for the next burst, send new burst
-        if (tsc_cur > tsc_next) {
-            tsc_next += tsc_incr;
+        // Each trial of the rate search restarts the schedule
+        if (search != NULL &&
+            unlikely(search_poll(conf->search.search, search, &rate))) {
+            paused = rate == 0;
+            if (!paused)
+                pacer_set_rate(&pacer, conf, rate, tsc_cur);
+        }
 
+        //  If it is already time for the next burst, send new burst; when
+        //  replaying with the original timing, send all packets already due
+        if (unlikely(paused))
+            howmany = 0;
+        else if (replay_timing)
+            howmany = replay_due(replay, &cursor, tsc_cur, conf->bst_size);
+        else
+            howmany = pacer_due(&pacer, tsc_cur);
+
+        if (howmany > 0) {
             num_sent =
-                prepare_send_burst(conf, socket, buffers, conf->bst_size);
+                prepare_send_burst(conf, socket, buffers, howmany, &cursor);
 
             // Errors are considered all dropped packets
             if (num_sent < 0) {
@@ -251,7 +312,10 @@ int send_loop(void *arg) {
             }
 
             stats_period.tx += num_sent;
-            stats_period.dropped += conf->bst_size - num_sent;
+            stats_period.dropped += howmany - num_sent;
+
+            if (search != NULL)
+                search_count(search, num_sent);
         }
     }
 
@@ -283,12 +347,16 @@ int recv_loop(void *arg) {
     struct stats stats = STATS_INIT;
 
     stats.type = STATS_RX;
-    stats_ptr = &stats;
+    stats_ptrs[conf->is_peer][conf->thread_id] = &stats;
 
     struct stats_data_rx stats_period = {0};
 
     /* --------------------------- Initialization --------------------------- */
 
+    struct capture_ring *capture = capture_ring_attach(conf);
+
+    struct search_slot *search = search_rx_attach(conf);
+
     /* ------------------ Infinite loop variables and body ------------------ */
 
     ssize_t num_recv;
@@ -313,7 +381,13 @@ int recv_loop(void *arg) {
             num_recv = 0;
         }
 
+        if (capture != NULL)
+            capture_burst(capture, socket, buffers, num_recv);
+
         stats_period.rx += num_recv;
+
+        if (search != NULL)
+            search_count(search, num_recv);
     }
 
     __builtin_unreachable();
@@ -326,11 +400,13 @@ int client_loop(void *arg) {
     /* ----------------------------- Constants ------------------------------ */
     const tsc_t tsc_hz = tsc_get_hz();
     const tsc_t tsc_out = tsc_hz; // Print stats once per second
-    const tsc_t tsc_incr = tsc_hz * conf->bst_size / conf->rate;
 
     const bool send_in_this_thread = strstr(conf->cmdname, "clientst") != NULL;
     const bool should_read_tsc = send_in_this_thread;
 
+    const struct replay *replay = conf->replay.replay;
+    const bool replay_timing = replay != NULL && conf->replay.timing;
+
     /* ------------------- Variables and data structures -------------------- */
 
     // Pointer to payload buffers
@@ -339,30 +415,53 @@ int client_loop(void *arg) {
     // Timers and counters
     tsc_t tsc_cur, tsc_prev;
     tsc_t tsc_pkt, tsc_diff;
-    tsc_t tsc_next;
+
+    // Departure schedule of packets
+    struct pacer pacer;
+
+    // Position in the replayed trace (if any)
+    struct replay_cursor cursor;
+
+    // Counters and delays of the latency search (if any), which starts paused
+    struct search_slot *search_tx =
+        send_in_this_thread ? search_tx_attach(conf) : NULL;
+    struct search_slot *search_rx = search_rx_attach(conf);
+    bool paused = search_rx != NULL;
+    bool recording = false;
+    tsc_t tsc_trial = 0;
+    rate_t rate;
 
     // Stats variables
     struct stats stats = STATS_INIT;
 
     stats.type = STATS_DELAY;
-    stats_ptr = &stats;
+    stats_ptrs[conf->is_peer][conf->thread_id] = &stats;
 
-    struct stats_data_delay stats_period = {0, 0};
+    struct stats_data_delay stats_period = {0};
+
+    // Delays measured in the current period
+    struct histogram delays;
+
+    histogram_reset(&delays);
 
     // --------------------------- Initialization --------------------------- //
 
     // ------------------ Infinite loop variables and body ------------------ //
 
-    ssize_t num_recv;
+    ssize_t num_recv, num_sent;
+    size_t howmany;
 
     if (should_read_tsc)
-        tsc_cur = tsc_prev = tsc_next = tsc_read();
+        tsc_cur = tsc_prev = tsc_read();
     else {
         do {
-            tsc_prev = tsc_cur = tsc_next = tsc_get_last();
+            tsc_prev = tsc_cur = tsc_get_last();
         } while (tsc_cur == 0);
     }
 
+    pacer_init(&pacer, conf, tsc_cur);
+    replay_cursor_init(&cursor, tsc_cur);
+
     for (ever) {
         if (should_read_tsc)
             tsc_cur = tsc_read();
@@ -372,17 +471,34 @@ int client_loop(void *arg) {
         // If more than a second elapsed
         if (tsc_cur - tsc_prev > tsc_out) {
             // Save, (print,) and reset stats
-            stats_save_reset_delay(&stats, &stats_period, conf);
+            stats_save_reset_delay(&stats, &stats_period, &delays, conf);
             // Update timers
             tsc_prev = tsc_cur;
         }
 
-        if (tsc_cur > tsc_next) {
-            tsc_next += tsc_incr;
+        // Each trial of the latency search restarts the schedule
+        if (search_rx != NULL &&
+            unlikely(search_poll_delays(conf->search.search, search_rx, &rate,
+                                        &recording, &tsc_trial))) {
+            paused = rate == 0;
+            if (!paused && send_in_this_thread)
+                pacer_set_rate(&pacer, conf, rate, tsc_cur);
+        }
 
-            if (send_in_this_thread) {
-                // Don't care if actually sent or not
-                prepare_send_burst(conf, socket, buffers, conf->bst_size);
+        // When replaying with the original timing, send all packets
+        // already due
+        if (send_in_this_thread && likely(!paused)) {
+            if (replay_timing)
+                howmany = replay_due(replay, &cursor, tsc_cur, conf->bst_size);
+            else
+                howmany = pacer_due(&pacer, tsc_cur);
+
+            // Don't care if actually sent or not, unless searching
+            if (howmany > 0) {
+                num_sent = prepare_send_burst(conf, socket, buffers, howmany,
+                                              &cursor);
+                if (search_tx != NULL && num_sent > 0)
+                    search_count(search_tx, num_sent);
             }
         }
 
@@ -395,19 +511,17 @@ int client_loop(void *arg) {
             else
                 tsc_cur = tsc_get_last();
 
-            // NOTICE: With this, packets with more than 0.1s delay are
-            // considered dropped
+            // NOTICE: With this, packets with more than 0.1s delay (or
+            // bogus timestamps) are considered dropped and counted apart
             tsc_diff = tsc_cur - tsc_pkt;
-            if (tsc_diff < tsc_hz / 10) {
-                // Add calculated delay to the avg attribute,
-                // which, to be honest, is actually the sum of all delays.
-                // The actual average is calculated only before saving it.
-                stats_period.avg += tsc_diff;
-                ++stats_period.num;
-            } else if (!conf->silent) {
-                printf("ERR: Received message with very big time difference: "
-                       "TSC DIFF %lu (TSC_HZ %lu)\n",
-                       tsc_diff, tsc_hz);
+            if (likely(tsc_diff < tsc_hz / 10)) {
+                histogram_record(&delays, tsc_diff);
+
+                // Late replies of previous trials don't count in this one
+                if (recording && tsc_pkt >= tsc_trial)
+                    histogram_record(search_rx->delays, tsc_diff);
+            } else {
+                ++stats_period.outliers;
             }
         }
     }
@@ -422,6 +536,8 @@ int server_loop(void *arg) {
     // Pointer to payload buffers
     buffer_t buffers[conf->bst_size];
 
+    struct capture_ring *capture = capture_ring_attach(conf);
+
     ssize_t num_recv;
 
     for (ever) {
@@ -430,8 +546,44 @@ int server_loop(void *arg) {
         if (num_recv < 0)
             num_recv = 0;
 
+        // Packets are captured before their headers are swapped
+        if (capture != NULL)
+            capture_burst(capture, socket, buffers, num_recv);
+
         nfv_socket_send_back(socket, num_recv);
     }
 
     __builtin_unreachable();
 }
+
+/**
+ * Loop that runs the throughput search (if any), on both sides of the test.
+ * Terminates the application once the search is over.
+ */
+int search_loop(void *arg) {
+    struct config *conf = (struct config *)arg;
+
+    search_run(conf);
+
+    __builtin_unreachable();
+}
+
+/**
+ * Infinite loop that writes to the capture file the packets captured by the
+ * receiving loops, so that they never wait for the disk. Stops writing once
+ * the capture is closed on termination.
+ */
+int capture_loop(void *arg) {
+    struct config *conf = (struct config *)arg;
+
+    capture_ptr = conf->capture.capture;
+
+    while (capture_write(capture_ptr) >= 0)
+        ;
+
+    for (ever) {
+        pause();
+    }
+
+    __builtin_unreachable();
+}
@@ -3,7 +3,11 @@
 #include "constants.h"
 
 #include "nfv_socket_dpdk.h"
+#include "nfv_socket_null.h"
+#include "nfv_socket_shm.h"
 #include "nfv_socket_simple.h"
+#include "nfv_socket_uring.h"
+#include "nfv_socket_xdp.h"
 
 /* ----------------------- CLASS FUNCTION DEFINITIONS ----------------------- */
 
@@ -13,6 +17,7 @@ NFV_SIGNATURE(void, init, config_ptr conf) {
     self->packet_size = conf->pkt_size;
     self->burst_size = conf->bst_size;
     self->payload_size = self->packet_size - PKT_HEADER_SIZE;
+    self->frame_headroom = 0;
 
     self->payloads = malloc(sizeof(buffer_t) * self->burst_size);
 }
@@ -23,6 +28,10 @@ nfv_socket_ptr nfv_socket_factory_get(config_ptr conf) {
     struct nfv_socket base;
     struct nfv_socket_simple *socket_simple;
     struct nfv_socket_dpdk *socket_dpdk;
+    struct nfv_socket_xdp *socket_xdp;
+    struct nfv_socket_uring *socket_uring;
+    struct nfv_socket_shm *socket_shm;
+    struct nfv_socket_null *socket_null;
 
     // Initialize base attributes
     nfv_socket_init(&base, conf);
@@ -62,6 +71,74 @@ nfv_socket_ptr nfv_socket_factory_get(config_ptr conf) {
         socket_dpdk->super = base;
         nfv_socket_dpdk_init((nfv_socket_ptr)socket_dpdk, conf);
         return (nfv_socket_ptr)socket_dpdk;
+
+    case NFV_SOCK_XDP:
+        socket_xdp = malloc(sizeof(struct nfv_socket_xdp));
+
+#ifdef USE_FPTRS
+        // Initialize methods of subclass
+        base.request_out_buffers = nfv_socket_xdp_request_out_buffers;
+        base.send = nfv_socket_xdp_send;
+        base.recv = nfv_socket_xdp_recv;
+        base.send_back = nfv_socket_xdp_send_back;
+#else
+        base.classcode = NFV_SOCK_XDP;
+#endif
+
+        socket_xdp->super = base;
+        nfv_socket_xdp_init((nfv_socket_ptr)socket_xdp, conf);
+        return (nfv_socket_ptr)socket_xdp;
+
+    case NFV_SOCK_URING:
+        socket_uring = malloc(sizeof(struct nfv_socket_uring));
+
+#ifdef USE_FPTRS
+        // Initialize methods of subclass
+        base.request_out_buffers = nfv_socket_uring_request_out_buffers;
+        base.send = nfv_socket_uring_send;
+        base.recv = nfv_socket_uring_recv;
+        base.send_back = nfv_socket_uring_send_back;
+#else
+        base.classcode = NFV_SOCK_URING;
+#endif
+
+        socket_uring->super = base;
+        nfv_socket_uring_init((nfv_socket_ptr)socket_uring, conf);
+        return (nfv_socket_ptr)socket_uring;
+
+    case NFV_SOCK_SHM:
+        socket_shm = malloc(sizeof(struct nfv_socket_shm));
+
+#ifdef USE_FPTRS
+        // Initialize methods of subclass
+        base.request_out_buffers = nfv_socket_shm_request_out_buffers;
+        base.send = nfv_socket_shm_send;
+        base.recv = nfv_socket_shm_recv;
+        base.send_back = nfv_socket_shm_send_back;
+#else
+        base.classcode = NFV_SOCK_SHM;
+#endif
+
+        socket_shm->super = base;
+        nfv_socket_shm_init((nfv_socket_ptr)socket_shm, conf);
+        return (nfv_socket_ptr)socket_shm;
+
+    case NFV_SOCK_NULL:
+        socket_null = malloc(sizeof(struct nfv_socket_null));
+
+#ifdef USE_FPTRS
+        // Initialize methods of subclass
+        base.request_out_buffers = nfv_socket_null_request_out_buffers;
+        base.send = nfv_socket_null_send;
+        base.recv = nfv_socket_null_recv;
+        base.send_back = nfv_socket_null_send_back;
+#else
+        base.classcode = NFV_SOCK_NULL;
+#endif
+
+        socket_null->super = base;
+        nfv_socket_null_init((nfv_socket_ptr)socket_null, conf);
+        return (nfv_socket_ptr)socket_null;
     default:
         assert(false);
         return NULL;
@@ -75,6 +152,14 @@ nfv_socket_ptr nfv_socket_factory_get(config_ptr conf) {
         return nfv_socket_simple_##method(self, ##__VA_ARGS__);                \
     else if ((self->classcode & NFV_SOCK_DPDK) != 0)                           \
         return nfv_socket_dpdk_##method(self, ##__VA_ARGS__);                  \
+    else if ((self->classcode & NFV_SOCK_XDP) != 0)                            \
+        return nfv_socket_xdp_##method(self, ##__VA_ARGS__);                   \
+    else if ((self->classcode & NFV_SOCK_URING) != 0)                          \
+        return nfv_socket_uring_##method(self, ##__VA_ARGS__);                 \
+    else if ((self->classcode & NFV_SOCK_SHM) != 0)                            \
+        return nfv_socket_shm_##method(self, ##__VA_ARGS__);                   \
+    else if ((self->classcode & NFV_SOCK_NULL) != 0)                           \
+        return nfv_socket_null_##method(self, ##__VA_ARGS__);                  \
     return 0;
 
 NFV_SIGNATURE(size_t, request_out_buffers, buffer_t buffers[], size_t howmany) {
@@ -1,8 +1,10 @@
 
 #include <rte_ethdev.h>
+#include <rte_lcore.h>
 
 #include "config.h"
 #include "constants.h"
+#include "dpdk.h"
 #include "nfv_socket_dpdk.h"
 
 #define dpdk_packet_start(p, t) rte_pktmbuf_mtod(p, t)
@@ -23,6 +25,10 @@ static inline struct rte_udp_hdr *dpdk_udp_hdr(struct rte_mbuf *pkt) {
 */
 
 static inline byte_t *dpdk_payload(struct rte_mbuf *pkt) {
+    // Chained packets keep the header and the payload in separate segments
+    if (pkt->next != NULL)
+        return dpdk_packet_start(pkt->next, byte_t *);
+
     return dpdk_packet_offset(pkt, byte_t *, OFFSET_PKT_PAYLOAD);
 }
 
@@ -61,29 +67,212 @@ static inline NFV_DPDK_SIGNATURE(void, fill_buffer_array, buffer_t buffers[],
     }
 }
 
-static inline void dpdk_prepare_packet(struct rte_mbuf *pkt, size_t size,
-                                       struct rte_ether_hdr *eth_hdr,
-                                       struct rte_ipv4_hdr *ip_hdr,
-                                       struct rte_udp_hdr *udp_hdr) {
-    rte_pktmbuf_reset_headroom(pkt);
+/**
+ * Takes howmany new outgoing packets from the TX pools, with their headers
+ * already in place. Packets too big for a single buffer are made of a header
+ * segment chained to a payload one.
+ *
+ * \return 0 on success, -1 if not enough buffers are available.
+ * */
+static inline NFV_DPDK_SIGNATURE(int, tx_alloc, rte_buffer_t packets[],
+                                 size_t howmany) {
+    struct nfv_socket_dpdk *sself = (struct nfv_socket_dpdk *)(self);
+    struct rte_mempool *pool = sself->tx_pools.packets;
+
+    // Buffers of the TX pools need no initialization other than their
+    // headers, see dpdk_tx_mbuf_init, so they can be taken all at once
+    if (unlikely(rte_mempool_get_bulk(pool, (void **)packets, howmany)))
+        return -1;
+
+    if (sself->tx_pools.payloads != NULL) {
+        if (unlikely(rte_mempool_get_bulk(sself->tx_pools.payloads,
+                                          (void **)sself->payload_segs,
+                                          howmany))) {
+            rte_mempool_put_bulk(pool, (void **)packets, howmany);
+            return -1;
+        }
+
+        // Segments are unchained each time they are freed
+        for (size_t i = 0; i < howmany; ++i) {
+            packets[i]->next = sself->payload_segs[i];
+            packets[i]->nb_segs = 2;
+        }
+    }
+
+    for (size_t i = 0; i < howmany; ++i)
+        rte_memcpy(dpdk_packet_start(packets[i], byte_t *),
+                   &sself->outgoing_hdr, PKT_HEADER_SIZE);
+
+    return 0;
+}
+
+/**
+ * Prepares the packets sent by each burst in static payload mode, which are
+ * kept by the socket for its whole lifetime.
+ * */
+static inline NFV_DPDK_SIGNATURE(void, static_init) {
+    struct nfv_socket_dpdk *sself = (struct nfv_socket_dpdk *)(self);
+
+    sself->static_packets = malloc(sizeof(rte_buffer_t) * self->burst_size);
+
+    if (sself->static_packets == NULL ||
+        nfv_socket_dpdk_tx_alloc(self, sself->static_packets,
+                                 self->burst_size)) {
+        fprintf(stderr, "DPDK ERROR: Could not allocate static packets!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < self->burst_size; ++i)
+        memset(dpdk_payload(sself->static_packets[i]), 0, self->payload_size);
+}
+
+/**
+ * Prepares the context used to split outgoing packets in IP fragments.
+ * */
+static inline NFV_DPDK_SIGNATURE(void, gso_init, config_ptr conf) {
+    struct nfv_socket_dpdk *sself = (struct nfv_socket_dpdk *)(self);
+
+    sself->gso_ctx.direct_pool = sself->tx_pools.gso_direct;
+    sself->gso_ctx.indirect_pool = sself->tx_pools.gso_indirect;
+    sself->gso_ctx.flag = 0;
+    sself->gso_ctx.gso_types = DEV_TX_OFFLOAD_UDP_TSO;
+    sself->gso_ctx.gso_size = sself->gso_size;
+
+    sself->gso_segs_size = self->burst_size * dpdk_gso_max_segs(conf);
+    sself->gso_segs = malloc(sizeof(rte_buffer_t) * sself->gso_segs_size);
+    sself->gso_counts = malloc(sizeof(uint16_t) * self->burst_size);
+
+    if (sself->gso_segs == NULL || sself->gso_counts == NULL) {
+        fprintf(stderr, "DPDK ERROR: Could not allocate GSO segments!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Splits the given packets in IP fragments and sends all of them at once.
+ * Packets are consumed even if not sent, since fragments reference their
+ * data; fragments not sent are dropped.
+ *
+ * \return the number of packets whose fragments were all sent.
+ * */
+static inline NFV_DPDK_SIGNATURE(ssize_t, gso_send, size_t howmany) {
+    struct nfv_socket_dpdk *sself = (struct nfv_socket_dpdk *)(self);
+    rte_buffer_t *packets = sself->packets + sself->used_buffers;
+    size_t nb_segs = 0;
+    size_t num_sent;
+    size_t num_sent_pkts = 0;
+    int res;
+
+    for (size_t i = 0; i < howmany; ++i) {
+        // Cleared by librte_gso on each packet it segments; lengths are
+        // not set on packets being sent back
+        packets[i]->ol_flags = PKT_TX_IPV4 | PKT_TX_UDP_SEG;
+        packets[i]->l2_len = sizeof(struct rte_ether_hdr);
+        packets[i]->l3_len = sizeof(struct rte_ipv4_hdr);
+
+        res = rte_gso_segment(packets[i], &sself->gso_ctx,
+                              sself->gso_segs + nb_segs,
+                              sself->gso_segs_size - nb_segs);
+        if (unlikely(res < 0)) {
+            rte_pktmbuf_free(packets[i]);
+            res = 0;
+        }
+
+        // librte_gso does not update checksums
+        for (int j = 0; j < res; ++j) {
+            struct rte_ipv4_hdr *ip_hdr = dpdk_packet_offset(
+                sself->gso_segs[nb_segs + j], struct rte_ipv4_hdr *,
+                OFFSET_PKT_IPV4);
+
+            ip_hdr->hdr_checksum = 0;
+            ip_hdr->hdr_checksum = rte_ipv4_cksum(ip_hdr);
+        }
+
+        sself->gso_counts[i] = res;
+        nb_segs += res;
+    }
+
+    sself->used_buffers += howmany;
+
+    num_sent = rte_eth_tx_burst(sself->portid, sself->queueid,
+                                sself->gso_segs, nb_segs);
+
+    for (size_t i = num_sent; unlikely(i < nb_segs); ++i)
+        rte_pktmbuf_free(sself->gso_segs[i]);
+
+    // Fragments are sent in order, so the packets sent are the first ones
+    for (size_t i = 0; i < howmany && sself->gso_counts[i] <= num_sent;
+         ++i) {
+        num_sent -= sself->gso_counts[i];
+        if (likely(sself->gso_counts[i] > 0))
+            ++num_sent_pkts;
+    }
+
+    return num_sent_pkts;
+}
+
+/**
+ * Copies a chained frame into a single buffer of the given pool, which is
+ * large enough for any frame.
+ *
+ * \return the copy, NULL if no buffer is available.
+ * */
+static inline struct rte_mbuf *dpdk_linear_copy(struct rte_mbuf *pkt,
+                                                struct rte_mempool *pool) {
+    struct rte_mbuf *copy = rte_pktmbuf_alloc(pool);
+    char *dst;
+
+    if (unlikely(copy == NULL))
+        return NULL;
+
+    dst = rte_pktmbuf_append(copy, pkt->pkt_len);
+    if (unlikely(dst == NULL)) {
+        rte_pktmbuf_free(copy);
+        return NULL;
+    }
 
-    // Only one segment containing the packet of size size
-    pkt->data_len = size;
-    pkt->pkt_len = pkt->data_len;
-    pkt->next = NULL;
-    pkt->nb_segs = 1;
-    pkt->ol_flags = 0;
-    pkt->vlan_tci = 0;
-    pkt->vlan_tci_outer = 0;
-    pkt->l2_len = sizeof(struct rte_ether_hdr);
-    pkt->l3_len = sizeof(struct rte_ipv4_hdr);
+    for (struct rte_mbuf *seg = pkt; seg != NULL; seg = seg->next) {
+        rte_memcpy(dst, rte_pktmbuf_mtod(seg, void *), seg->data_len);
+        dst += seg->data_len;
+    }
 
-    byte_t *start = dpdk_packet_start(pkt, byte_t *);
+    copy->port = pkt->port;
+    copy->ol_flags = pkt->ol_flags;
+    copy->packet_type = pkt->packet_type;
 
-    // Copy all headers in the packet
-    rte_memcpy(start + OFFSET_PKT_ETHER, eth_hdr, sizeof(struct rte_ether_hdr));
-    rte_memcpy(start + OFFSET_PKT_IPV4, ip_hdr, sizeof(struct rte_ipv4_hdr));
-    rte_memcpy(start + OFFSET_PKT_UDP, udp_hdr, sizeof(struct rte_udp_hdr));
+    return copy;
+}
+
+/**
+ * Merges the segments of received frames that the device scattered in
+ * multiple buffers, so that payloads are handed to the application in one
+ * piece. Frames whose first buffer has no room for the whole frame (e.g. the
+ * header segments of jumbo frames in loopback tests) are copied to a buffer
+ * of the RX pool instead; frames that cannot be merged either way are
+ * dropped.
+ *
+ * \return the number of packets left.
+ * */
+static inline NFV_DPDK_SIGNATURE(size_t, rx_linearize, size_t howmany) {
+    struct nfv_socket_dpdk *sself = (struct nfv_socket_dpdk *)(self);
+    size_t num_good = 0;
+
+    for (size_t i = 0; i < howmany; ++i) {
+        struct rte_mbuf *pkt = sself->packets[i];
+        struct rte_mbuf *copy;
+
+        if (unlikely(pkt->nb_segs > 1) && rte_pktmbuf_linearize(pkt)) {
+            copy = dpdk_linear_copy(pkt, sself->rx_pool);
+            rte_pktmbuf_free(pkt);
+            if (copy == NULL)
+                continue;
+            pkt = copy;
+        }
+
+        sself->packets[num_good++] = pkt;
+    }
+
+    return num_good;
 }
 
 NFV_DPDK_SIGNATURE(void, init, config_ptr conf) {
@@ -93,13 +282,39 @@ NFV_DPDK_SIGNATURE(void, init, config_ptr conf) {
     sself->used_buffers = 0;
 
     sself->portid = conf->dpdk.portid;
-    sself->mbufs = conf->dpdk.mbufs;
+    sself->queueid = conf->thread_id;
+    sself->nb_ports = conf->num_threads;
+    sself->hw_filtered = conf->dpdk.flow_filtered;
+    // New packets are taken from the pools local to the core of this thread
+    sself->tx_pools = conf->dpdk.tx_pools[rte_socket_id()];
+    sself->rx_linearize =
+        conf->pkt_size + RTE_ETHER_CRC_LEN > RTE_ETHER_MAX_LEN;
+    sself->rx_pool = conf->dpdk.mbufs;
+    sself->gso_size = conf->dpdk.gso_size;
+    self->frame_headroom = PKT_HEADER_SIZE;
 
     sself->packets = malloc(sizeof(rte_buffer_t) * self->burst_size);
+    sself->payload_segs = malloc(sizeof(rte_buffer_t) * self->burst_size);
+
+    if (sself->packets == NULL || sself->payload_segs == NULL) {
+        fprintf(stderr, "DPDK ERROR: Could not allocate packet arrays!\n");
+        exit(EXIT_FAILURE);
+    }
 
     // Setup packet headers
     pkt_hdr_setup(&sself->incoming_hdr, conf, DIR_INCOMING);
     pkt_hdr_setup(&sself->outgoing_hdr, conf, DIR_OUTGOING);
+
+    // Each thread sends from a different source port, so that RSS on the
+    // receiving side spreads the flows of different threads among its queues
+    hdr_offset_src_port(&sself->outgoing_hdr, conf->thread_id);
+
+    if (sself->gso_size)
+        nfv_socket_dpdk_gso_init(self, conf);
+
+    sself->static_payloads = conf->dpdk.static_payloads;
+    if (sself->static_payloads)
+        nfv_socket_dpdk_static_init(self);
 }
 
 NFV_DPDK_SIGNATURE(size_t, request_out_buffers, buffer_t buffers[],
@@ -111,25 +326,29 @@ NFV_DPDK_SIGNATURE(size_t, request_out_buffers, buffer_t buffers[],
 
     nfv_socket_dpdk_free_buffers(self);
 
-    size_t i;
-    for (i = 0; i < howmany; ++i) {
-        // FIXME: from DPDK documentation, "for standard use, prefer
-        // rte_pktmbuf_alloc()"
-        sself->packets[i] = rte_mbuf_raw_alloc(sself->mbufs);
-        if (unlikely(sself->packets[i] == NULL)) {
-            fprintf(stderr,
-                    "WARN: Could not allocate buffer, using %lu instead of the "
-                    "%lu requested buffers!\n",
-                    i, howmany);
-            break;
+    // Static packets are only referenced once more, so that the PMD releases
+    // this reference only after sending them; references of unsent ones are
+    // released by free_buffers
+    if (sself->static_payloads) {
+        for (size_t i = 0; i < howmany; ++i) {
+            sself->packets[i] = sself->static_packets[i];
+            for (struct rte_mbuf *seg = sself->packets[i]; seg != NULL;
+                 seg = seg->next)
+                rte_mbuf_refcnt_update(seg, 1);
         }
 
-        dpdk_prepare_packet(sself->packets[i], self->packet_size,
-                            &sself->outgoing_hdr.ether, &sself->outgoing_hdr.ip,
-                            &sself->outgoing_hdr.udp);
+        sself->active_buffers = howmany;
+        nfv_socket_dpdk_fill_buffer_array(self, buffers, howmany);
+
+        return sself->active_buffers;
+    }
+
+    if (unlikely(nfv_socket_dpdk_tx_alloc(self, sself->packets, howmany))) {
+        fprintf(stderr, "WARN: Could not allocate %lu buffers!\n", howmany);
+        return 0;
     }
 
-    sself->active_buffers += i;
+    sself->active_buffers = howmany;
     nfv_socket_dpdk_fill_buffer_array(self, buffers, howmany);
 
     return sself->active_buffers;
@@ -146,8 +365,10 @@ NFV_DPDK_SIGNATURE(ssize_t, send, size_t howmany) {
     if (unlikely(howmany == 0))
         return 0;
 
-    // TODO: rte_eth_dev_configure with queues?
-    num_sent = rte_eth_tx_burst(sself->portid, 0,
+    if (sself->gso_size)
+        return nfv_socket_dpdk_gso_send(self, howmany);
+
+    num_sent = rte_eth_tx_burst(sself->portid, sself->queueid,
                                 sself->packets + sself->used_buffers, howmany);
 
     if (likely(num_sent > 0))
@@ -175,27 +396,39 @@ NFV_DPDK_SIGNATURE(ssize_t, recv, buffer_t buffers[], size_t howmany) {
 
     nfv_socket_dpdk_free_buffers(self);
 
-    num_recv = rte_eth_rx_burst(sself->portid, 0, sself->packets, howmany);
+    num_recv = rte_eth_rx_burst(sself->portid, sself->queueid, sself->packets,
+                                howmany);
     num_recv_good = 0;
 
     // I put a "likely" here to prefer scenarios in which there is actually
     // something to do with the incoming packets.
     if (likely(num_recv > 0)) {
-        // Filter-out packets NOT meant for this application
-        for (i = 0; i < num_recv; ++i) {
-            const struct pkt_hdr *header =
-                dpdk_packet_start(sself->packets[i], struct pkt_hdr *);
-
-            if (hdr_check_incoming(header, &sself->incoming_hdr)) {
-                // Packet was meant for this application!
-                sself->packets[num_recv_good] = sself->packets[i];
-                ++num_recv_good;
-            } else {
-                // Free this buffer, do not increase num_recv_good
-                rte_pktmbuf_free(sself->packets[i]);
+        if (sself->hw_filtered) {
+            // Flow rules already dropped packets NOT meant for this
+            // application
+            num_recv_good = num_recv;
+        } else {
+            // Filter-out packets NOT meant for this application
+            for (i = 0; i < num_recv; ++i) {
+                const struct pkt_hdr *header =
+                    dpdk_packet_start(sself->packets[i], struct pkt_hdr *);
+
+                if (hdr_check_incoming_ports(header, &sself->incoming_hdr,
+                                             sself->nb_ports)) {
+                    // Packet was meant for this application!
+                    sself->packets[num_recv_good] = sself->packets[i];
+                    ++num_recv_good;
+                } else {
+                    // Free this buffer, do not increase num_recv_good
+                    rte_pktmbuf_free(sself->packets[i]);
+                }
             }
         }
 
+        if (unlikely(sself->rx_linearize))
+            num_recv_good =
+                nfv_socket_dpdk_rx_linearize(self, num_recv_good);
+
         sself->active_buffers += num_recv_good;
     }
 
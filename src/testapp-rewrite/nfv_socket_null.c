@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "config.h"
+#include "constants.h"
+#include "nfv_socket_null.h"
+#include "payload_util.h"
+
+/* Number of packets in the receive ring, larger than any burst so that
+ * received packets are not always found in the cache */
+#define NULL_RING_SIZE 1024
+#define NULL_RING_MASK (NULL_RING_SIZE - 1)
+
+static inline byte_t *null_packet(byte_t *area, size_t packet_size,
+                                  size_t idx) {
+    return area + idx * packet_size;
+}
+
+static inline NFV_NULL_SIGNATURE(void, free_buffers) {
+    struct nfv_socket_null *sself = (struct nfv_socket_null *)(self);
+
+    sself->used_buffers = 0;
+    sself->active_buffers = 0;
+}
+
+NFV_NULL_SIGNATURE(void, init, config_ptr conf) {
+    struct nfv_socket_null *sself = (struct nfv_socket_null *)(self);
+    byte_t *packet;
+
+    sself->active_buffers = 0;
+    sself->used_buffers = 0;
+    sself->rx_next = 0;
+    self->frame_headroom = PKT_HEADER_SIZE;
+
+    // Setup packet headers
+    pkt_hdr_setup(&sself->incoming_hdr, conf, DIR_INCOMING);
+    pkt_hdr_setup(&sself->outgoing_hdr, conf, DIR_OUTGOING);
+
+    // Outgoing headers are written once, only payloads are written later
+    sself->tx_area = malloc(self->packet_size * self->burst_size);
+    if (sself->tx_area == NULL) {
+        perror("NULL ERROR: could not allocate buffers");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < self->burst_size; ++i) {
+        packet = null_packet(sself->tx_area, self->packet_size, i);
+        rte_memcpy(packet, &sself->outgoing_hdr, sizeof(struct pkt_hdr));
+    }
+
+    // Incoming packets are valid for this application and carry a payload
+    // that passes the check performed when data are consumed
+    sself->rx_area = malloc(self->packet_size * NULL_RING_SIZE);
+    if (sself->rx_area == NULL) {
+        perror("NULL ERROR: could not allocate buffers");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < NULL_RING_SIZE; ++i) {
+        packet = null_packet(sself->rx_area, self->packet_size, i);
+        rte_memcpy(packet, &sself->incoming_hdr, sizeof(struct pkt_hdr));
+        put_i64_offset(packet, OFFSET_PKT_TIMESTAMP, 0);
+        produce_data_offset(packet, self->payload_size - sizeof(tsc_t),
+                            OFFSET_PKT_DATA);
+    }
+}
+
+NFV_NULL_SIGNATURE(size_t, request_out_buffers, buffer_t buffers[],
+                   size_t howmany) {
+    struct nfv_socket_null *sself = (struct nfv_socket_null *)(self);
+
+    if (unlikely(howmany > self->burst_size))
+        howmany = self->burst_size;
+
+    nfv_socket_null_free_buffers(self);
+
+    for (size_t i = 0; i < howmany; ++i)
+        buffers[i] = null_packet(sself->tx_area, self->packet_size, i) +
+                     OFFSET_PKT_PAYLOAD;
+
+    sself->active_buffers = howmany;
+
+    return howmany;
+}
+
+NFV_NULL_SIGNATURE(ssize_t, send, size_t howmany) {
+    struct nfv_socket_null *sself = (struct nfv_socket_null *)(self);
+
+    if (unlikely(howmany > sself->active_buffers - sself->used_buffers))
+        howmany = sself->active_buffers - sself->used_buffers;
+
+    // Packets are simply discarded
+    sself->used_buffers += howmany;
+
+    return howmany;
+}
+
+NFV_NULL_SIGNATURE(ssize_t, recv, buffer_t buffers[], size_t howmany) {
+    struct nfv_socket_null *sself = (struct nfv_socket_null *)(self);
+    size_t num_recv = 0;
+    byte_t *packet;
+
+    if (unlikely(howmany > self->burst_size))
+        howmany = self->burst_size;
+
+    nfv_socket_null_free_buffers(self);
+
+    for (size_t i = 0; i < howmany; ++i) {
+        packet = null_packet(sself->rx_area, self->packet_size,
+                             (sself->rx_next + i) & NULL_RING_MASK);
+
+        // Filter-out packets NOT meant for this application, as other sockets
+        // do (none, actually)
+        if (likely(hdr_check_incoming((const struct pkt_hdr *)packet,
+                                      &sself->incoming_hdr)))
+            buffers[num_recv++] = packet + OFFSET_PKT_PAYLOAD;
+    }
+
+    sself->rx_next = (sself->rx_next + howmany) & NULL_RING_MASK;
+    sself->active_buffers = num_recv;
+
+    return num_recv;
+}
+
+NFV_NULL_SIGNATURE(ssize_t, send_back, size_t howmany) {
+    // Nothing to swap, packets are discarded anyway
+    return nfv_socket_null_send(self, howmany);
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "config.h"
+#include "constants.h"
+#include "nfv_socket_shm.h"
+
+#define SHM_RING_MASK (SHM_RING_SIZE - 1)
+
+static inline struct shm_desc *shm_desc_at(struct shm_ring *ring,
+                                           uint32_t idx) {
+    return &ring->desc[idx & SHM_RING_MASK];
+}
+
+/**
+ * Returns the number of TX descriptors owned by this application, reading
+ * the consumer index only if the cached one does not allow howmany of them.
+ * */
+static inline uint32_t shm_tx_free(struct nfv_socket_shm *sself,
+                                   uint32_t howmany) {
+    uint32_t free = SHM_RING_SIZE - (sself->tx_head - sself->tx_tail);
+
+    if (free < howmany) {
+        sself->tx_tail =
+            __atomic_load_n(&sself->chan->tx->tail, __ATOMIC_ACQUIRE);
+        free = SHM_RING_SIZE - (sself->tx_head - sself->tx_tail);
+    }
+
+    return free;
+}
+
+static inline void shm_tx_publish(struct nfv_socket_shm *sself,
+                                  uint32_t howmany) {
+    sself->tx_head += howmany;
+    __atomic_store_n(&sself->chan->tx->head, sself->tx_head, __ATOMIC_RELEASE);
+}
+
+static inline NFV_SHM_SIGNATURE(void, free_buffers) {
+    struct nfv_socket_shm *sself = (struct nfv_socket_shm *)(self);
+
+    // Received descriptors are given back all together, with the buffers
+    // they reference at this time. Requested but unsent TX descriptors are
+    // simply never published.
+    if (sself->rx_owned && sself->rx_taken > 0) {
+        sself->rx_tail += sself->rx_taken;
+        __atomic_store_n(&sself->chan->rx->tail, sself->rx_tail,
+                         __ATOMIC_RELEASE);
+        sself->rx_taken = 0;
+    }
+
+    sself->used_buffers = 0;
+    sself->active_buffers = 0;
+}
+
+NFV_SHM_SIGNATURE(void, init, config_ptr conf) {
+    struct nfv_socket_shm *sself = (struct nfv_socket_shm *)(self);
+    struct shm_channel *chan = conf->shm.chan;
+
+    sself->chan = chan;
+    sself->active_buffers = 0;
+    sself->used_buffers = 0;
+    sself->rx_owned = false;
+    sself->rx_taken = 0;
+
+    // Resume from the current state of the rings, the other application may
+    // already be running
+    sself->tx_head = __atomic_load_n(&chan->tx->head, __ATOMIC_ACQUIRE);
+    sself->tx_tail = __atomic_load_n(&chan->tx->tail, __ATOMIC_ACQUIRE);
+    sself->rx_head = __atomic_load_n(&chan->rx->head, __ATOMIC_ACQUIRE);
+    sself->rx_tail = __atomic_load_n(&chan->rx->tail, __ATOMIC_ACQUIRE);
+
+    sself->rx_slots = malloc(sizeof(uint32_t) * self->burst_size);
+    if (sself->rx_slots == NULL) {
+        perror("SHM ERROR: could not allocate buffers");
+        exit(EXIT_FAILURE);
+    }
+}
+
+NFV_SHM_SIGNATURE(size_t, request_out_buffers, buffer_t buffers[],
+                  size_t howmany) {
+    struct nfv_socket_shm *sself = (struct nfv_socket_shm *)(self);
+    struct shm_ring *tx = sself->chan->tx;
+    uint32_t free;
+
+    if (unlikely(howmany > self->burst_size))
+        howmany = self->burst_size;
+
+    nfv_socket_shm_free_buffers(self);
+
+    free = shm_tx_free(sself, howmany);
+    if (unlikely(howmany > free))
+        howmany = free;
+
+    for (size_t i = 0; i < howmany; ++i)
+        buffers[i] =
+            shm_buf(sself->chan, shm_desc_at(tx, sself->tx_head + i)->buf);
+
+    sself->active_buffers = howmany;
+    sself->rx_owned = false;
+
+    return howmany;
+}
+
+NFV_SHM_SIGNATURE(ssize_t, send, size_t howmany) {
+    struct nfv_socket_shm *sself = (struct nfv_socket_shm *)(self);
+    struct shm_ring *tx = sself->chan->tx;
+
+    if (unlikely(howmany > sself->active_buffers - sself->used_buffers))
+        howmany = sself->active_buffers - sself->used_buffers;
+
+    if (unlikely(howmany == 0))
+        return 0;
+
+    for (size_t i = 0; i < howmany; ++i)
+        shm_desc_at(tx, sself->tx_head + i)->len = self->payload_size;
+
+    shm_tx_publish(sself, howmany);
+
+    sself->used_buffers += howmany;
+
+    return howmany;
+}
+
+NFV_SHM_SIGNATURE(ssize_t, recv, buffer_t buffers[], size_t howmany) {
+    struct nfv_socket_shm *sself = (struct nfv_socket_shm *)(self);
+    struct shm_ring *rx = sself->chan->rx;
+    uint32_t available;
+    size_t num_recv = 0;
+
+    if (unlikely(howmany > self->burst_size))
+        howmany = self->burst_size;
+
+    nfv_socket_shm_free_buffers(self);
+
+    available = sself->rx_head - sself->rx_tail;
+    if (available < howmany) {
+        sself->rx_head = __atomic_load_n(&rx->head, __ATOMIC_ACQUIRE);
+        available = sself->rx_head - sself->rx_tail;
+    }
+
+    if (available > howmany)
+        available = howmany;
+
+    for (uint32_t i = 0; i < available; ++i) {
+        const struct shm_desc *desc = shm_desc_at(rx, sself->rx_tail + i);
+
+        // Payloads of unexpected size are discarded
+        if (unlikely(desc->len != self->payload_size))
+            continue;
+
+        sself->rx_slots[num_recv] = sself->rx_tail + i;
+        buffers[num_recv] = shm_buf(sself->chan, desc->buf);
+        ++num_recv;
+    }
+
+    sself->rx_taken = available;
+    sself->rx_owned = true;
+    sself->active_buffers = num_recv;
+
+    return num_recv;
+}
+
+NFV_SHM_SIGNATURE(ssize_t, send_back, size_t howmany) {
+    struct nfv_socket_shm *sself = (struct nfv_socket_shm *)(self);
+    struct shm_ring *tx = sself->chan->tx;
+    struct shm_ring *rx = sself->chan->rx;
+    uint32_t free;
+
+    if (unlikely(howmany > sself->active_buffers - sself->used_buffers))
+        howmany = sself->active_buffers - sself->used_buffers;
+
+    if (unlikely(howmany == 0))
+        return 0;
+
+    free = shm_tx_free(sself, howmany);
+    if (unlikely(howmany > free))
+        howmany = free;
+
+    // Received buffers are moved to the TX ring as they are; the RX
+    // descriptors take the buffers of the TX ones instead, which go back to
+    // the other application on the next recv
+    for (size_t i = 0; i < howmany; ++i) {
+        struct shm_desc *rx_desc =
+            shm_desc_at(rx, sself->rx_slots[sself->used_buffers + i]);
+        struct shm_desc *tx_desc = shm_desc_at(tx, sself->tx_head + i);
+        uint32_t buf = tx_desc->buf;
+
+        tx_desc->buf = rx_desc->buf;
+        tx_desc->len = rx_desc->len;
+        rx_desc->buf = buf;
+    }
+
+    shm_tx_publish(sself, howmany);
+
+    sself->used_buffers += howmany;
+
+    return howmany;
+}
@@ -3,14 +3,487 @@
 #define _GNU_SOURCE
 #endif
 
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 
+#include <linux/errqueue.h>
+
 #include "config.h"
 #include "constants.h"
 #include "nfv_socket_simple.h"
 
 // FIXME: all kinds of error checking for mallocs...
 
+/* ------------------------- PACKET_MMAP RING MODE -------------------------- */
+
+static inline NFV_SIMPLE_SIGNATURE(size_t, ring_request_out_buffers,
+                                   buffer_t buffers[], size_t howmany) {
+    struct nfv_socket_simple *sself = (struct nfv_socket_simple *)(self);
+    struct packet_ring *ring = sself->ring;
+    size_t i;
+
+    // Frames are taken in order starting from the next one to be sent, so
+    // unused frames are simply picked again by the next call
+    for (i = 0; i < howmany; ++i) {
+        struct tpacket3_hdr *frame =
+            packet_ring_tx_frame(ring, ring->tx_frame + i);
+
+        if (unlikely(!packet_ring_tx_frame_available(frame)))
+            break;
+
+        sself->packets[i] = packet_ring_tx_data(frame);
+        rte_memcpy(sself->packets[i], sself->frame_hdr, PKT_HEADER_SIZE);
+        buffers[i] = sself->packets[i] + sself->base_offset;
+    }
+
+    sself->active_buffers = i;
+    sself->used_buffers = 0;
+
+    return i;
+}
+
+static inline NFV_SIMPLE_SIGNATURE(ssize_t, ring_send, size_t howmany) {
+    struct nfv_socket_simple *sself = (struct nfv_socket_simple *)(self);
+    struct packet_ring *ring = sself->ring;
+
+    for (size_t i = 0; i < howmany; ++i)
+        packet_ring_tx_frame_submit(
+            packet_ring_tx_frame(ring, ring->tx_frame + i), sself->used_size);
+
+    ring->tx_frame = (ring->tx_frame + howmany) % ring->tx_req.tp_frame_nr;
+
+    // One system call flushes all the frames marked for sending. Frames that
+    // could not be sent right away stay in the ring and are sent by the next
+    // call, so they are not reported as dropped.
+    sendto(sself->sock_fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+
+    sself->used_buffers += howmany;
+
+    return howmany;
+}
+
+/**
+ * Copies packets received in the RX ring into TX frames, so that they can be
+ * sent back by ring_send.
+ *
+ * \return the number of packets that found a free TX frame.
+ * */
+static inline NFV_SIMPLE_SIGNATURE(size_t, ring_copy_to_tx, size_t howmany) {
+    struct nfv_socket_simple *sself = (struct nfv_socket_simple *)(self);
+    struct packet_ring *ring = sself->ring;
+    size_t i;
+
+    for (i = 0; i < howmany; ++i) {
+        size_t j = i + sself->used_buffers;
+        struct tpacket3_hdr *frame =
+            packet_ring_tx_frame(ring, ring->tx_frame + i);
+
+        if (unlikely(!packet_ring_tx_frame_available(frame)))
+            break;
+
+        rte_memcpy(packet_ring_tx_data(frame), sself->packets[j],
+                   sself->used_size);
+        sself->packets[j] = packet_ring_tx_data(frame);
+    }
+
+    return i;
+}
+
+static inline NFV_SIMPLE_SIGNATURE(ssize_t, ring_recv, buffer_t buffers[],
+                                   size_t howmany) {
+    struct nfv_socket_simple *sself = (struct nfv_socket_simple *)(self);
+    struct packet_ring *ring = sself->ring;
+    struct tpacket_block_desc *block =
+        packet_ring_rx_block(ring, ring->rx_block);
+    size_t num_recv_good = 0;
+
+    // Implicit free of all previously acquired buffers: once the current
+    // block has been fully consumed, it is given back to the kernel
+    if (ring->rx_next != NULL && ring->rx_pkt == block->hdr.bh1.num_pkts) {
+        packet_ring_rx_block_release(block);
+        ring->rx_block = (ring->rx_block + 1) % ring->rx_req.tp_block_nr;
+        ring->rx_next = NULL;
+        block = packet_ring_rx_block(ring, ring->rx_block);
+    }
+
+    sself->active_buffers = 0;
+    sself->used_buffers = 0;
+
+    if (!packet_ring_rx_block_ready(block))
+        return 0;
+
+    if (ring->rx_next == NULL) {
+        ring->rx_next =
+            (struct tpacket3_hdr *)((byte_t *)block +
+                                    block->hdr.bh1.offset_to_first_pkt);
+        ring->rx_pkt = 0;
+    }
+
+    for (; num_recv_good < howmany && ring->rx_pkt < block->hdr.bh1.num_pkts;
+         ++ring->rx_pkt) {
+        struct tpacket3_hdr *pkt_hdr = ring->rx_next;
+        byte_t *packet = (byte_t *)pkt_hdr + pkt_hdr->tp_mac;
+
+        ring->rx_next = (struct tpacket3_hdr *)((byte_t *)pkt_hdr +
+                                                pkt_hdr->tp_next_offset);
+
+        // Filter-out packets NOT meant for this application
+        if (pkt_hdr->tp_snaplen >= sself->used_size &&
+            hdr_check_incoming_ports((struct pkt_hdr *)packet,
+                                     &sself->incoming_hdr, sself->nb_ports)) {
+            sself->packets[num_recv_good] = packet;
+            buffers[num_recv_good] = packet + sself->base_offset;
+            ++num_recv_good;
+        }
+    }
+
+    sself->active_buffers = num_recv_good;
+
+    return num_recv_good;
+}
+
+/* --------------------------- MSG_ZEROCOPY MODE --------------------------- */
+
+/* Number of bursts that can be in flight at the same time */
+#define ZC_POOL_BURSTS 8
+
+/* Big enough for a sock_extended_err followed by the offender address */
+#define ZC_CONTROL_SIZE 128
+
+static inline size_t zc_free_count(struct nfv_socket_simple *sself) {
+    return sself->zc_free_tail - sself->zc_free_head;
+}
+
+static inline void zc_free_push(struct nfv_socket_simple *sself,
+                                byte_t *packet) {
+    sself->zc_free[sself->zc_free_tail++ % sself->zc_pool_size] = packet;
+}
+
+static inline byte_t *zc_free_pop(struct nfv_socket_simple *sself) {
+    return sself->zc_free[sself->zc_free_head++ % sself->zc_pool_size];
+}
+
+/**
+ * Gives back to the pool the buffers pointed by iovecs [first, first +
+ * howmany), which the kernel does not hold.
+ * */
+static inline void zc_recycle(struct nfv_socket_simple *sself, size_t first,
+                              size_t howmany) {
+    for (size_t i = 0; i < howmany; ++i)
+        zc_free_push(sself, sself->iovecs[first + i].iov_base);
+}
+
+/**
+ * Records that the buffers pointed by iovecs [first, first + howmany) have
+ * been given to the kernel by a single successful system call.
+ * */
+static inline void zc_track(struct nfv_socket_simple *sself, size_t first,
+                            size_t howmany) {
+    uint32_t id = sself->zc_next_id++;
+
+    sself->zc_completed[id % sself->zc_pool_size] = false;
+
+    for (size_t i = 0; i < howmany; ++i) {
+        size_t idx = sself->zc_tail++ % sself->zc_pool_size;
+        sself->zc_inflight[idx] = sself->iovecs[first + i].iov_base;
+        sself->zc_inflight_id[idx] = id;
+    }
+}
+
+/**
+ * Reads all the notifications from the socket error queue, then gives back
+ * to the pool all the buffers whose transmission has been completed.
+ *
+ * NOTICE: ids of buffers still in flight cannot collide modulo the pool size,
+ * since each id is used by at least one buffer of the pool.
+ * */
+static inline void zc_reap(struct nfv_socket_simple *sself) {
+    char control[ZC_CONTROL_SIZE];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    const struct sock_extended_err *ee;
+
+    for (;;) {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        // Never blocks, fails when the queue is empty
+        if (recvmsg(sself->sock_fd, &msg, MSG_ERRQUEUE) < 0)
+            break;
+
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+             cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR)
+                continue;
+
+            ee = (const struct sock_extended_err *)CMSG_DATA(cmsg);
+            if (ee->ee_errno != 0 || ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+
+            // Notifications carry an inclusive range of ids
+            for (uint32_t id = ee->ee_info; id != ee->ee_data + 1; ++id)
+                sself->zc_completed[id % sself->zc_pool_size] = true;
+        }
+    }
+
+    while (sself->zc_head != sself->zc_tail) {
+        size_t idx = sself->zc_head % sself->zc_pool_size;
+        uint32_t id = sself->zc_inflight_id[idx];
+
+        if (!sself->zc_completed[id % sself->zc_pool_size])
+            break;
+
+        zc_free_push(sself, sself->zc_inflight[idx]);
+        ++sself->zc_head;
+    }
+}
+
+/**
+ * Gives back to the pool all the buffers that were requested but not sent.
+ * */
+static inline void zc_release_unsent(struct nfv_socket_simple *sself) {
+    if (!sself->zc_outgoing)
+        return;
+
+    zc_recycle(sself, sself->used_buffers,
+               sself->active_buffers - sself->used_buffers);
+    sself->used_buffers = sself->active_buffers;
+}
+
+static inline NFV_SIMPLE_SIGNATURE(size_t, zc_request_out_buffers,
+                                   buffer_t buffers[], size_t howmany) {
+    struct nfv_socket_simple *sself = (struct nfv_socket_simple *)(self);
+
+    zc_release_unsent(sself);
+
+    // Notifications are read only when the pool runs short, so that each
+    // read collects many of them
+    if (zc_free_count(sself) < howmany)
+        zc_reap(sself);
+
+    if (unlikely(howmany > zc_free_count(sself)))
+        howmany = zc_free_count(sself);
+
+    for (size_t i = 0; i < howmany; ++i) {
+        byte_t *packet = zc_free_pop(sself);
+        sself->iovecs[i].iov_base = packet;
+        buffers[i] = packet;
+    }
+
+    sself->active_buffers = howmany;
+    sself->used_buffers = 0;
+    sself->zc_outgoing = true;
+
+    return howmany;
+}
+
+/**
+ * Makes vectors point again to the buffers used for reception, which are
+ * always sent back by copy.
+ * */
+static inline NFV_SIMPLE_SIGNATURE(void, zc_prepare_recv, size_t howmany) {
+    struct nfv_socket_simple *sself = (struct nfv_socket_simple *)(self);
+
+    zc_release_unsent(sself);
+
+    for (size_t i = 0; i < howmany; ++i)
+        sself->iovecs[i].iov_base = sself->packets[i];
+
+    sself->zc_outgoing = false;
+}
+
+/* --------------------------- UDP GSO/GRO MODE ---------------------------- */
+
+/* Maximum size of a segmented/coalesced UDP payload [bytes] */
+#define GSO_MAX_BYTES                                                          \
+    (0xFFFF - sizeof(struct rte_ipv4_hdr) - sizeof(struct rte_udp_hdr))
+
+/* Maximum number of segments per send (UDP_MAX_SEGMENTS on older kernels) */
+#define GSO_MAX_SEGMENTS 64
+
+#define GRO_BUF_SIZE 0x10000
+
+/**
+ * Returns the size of each datagram coalesced in a received buffer.
+ * */
+static inline size_t gro_segment_size(struct msghdr *msg, size_t len) {
+    struct cmsghdr *cmsg;
+    int gso_size;
+
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+            return gso_size;
+        }
+    }
+
+    // Not coalesced, this is a single datagram
+    return len;
+}
+
+static inline NFV_SIMPLE_SIGNATURE(ssize_t, gso_send, size_t howmany) {
+    struct nfv_socket_simple *sself = (struct nfv_socket_simple *)(self);
+    size_t max_segments = GSO_MAX_BYTES / sself->used_size;
+    size_t num_sent = 0;
+    int flags = sself->zc_outgoing ? MSG_ZEROCOPY : 0;
+    struct msghdr msg;
+
+    if (max_segments > GSO_MAX_SEGMENTS)
+        max_segments = GSO_MAX_SEGMENTS;
+
+    memset(&msg, 0, sizeof(msg));
+
+    // The kernel splits each send in datagrams of used_size bytes (see
+    // UDP_SEGMENT), all of them are sent or none is
+    while (num_sent < howmany) {
+        size_t segments = howmany - num_sent;
+
+        if (segments > max_segments)
+            segments = max_segments;
+
+        msg.msg_iov = &sself->iovecs[sself->used_buffers + num_sent];
+        msg.msg_iovlen = segments;
+
+        if (sendmsg(sself->sock_fd, &msg, flags) < 0) {
+            // Zerocopy sends fail when payloads span too many pages, in that
+            // case the kernel copies them and they can be reused right away
+            if (!sself->zc_outgoing || errno != EMSGSIZE ||
+                sendmsg(sself->sock_fd, &msg, 0) < 0)
+                break;
+
+            zc_recycle(sself, sself->used_buffers + num_sent, segments);
+        } else if (sself->zc_outgoing) {
+            zc_track(sself, sself->used_buffers + num_sent, segments);
+        }
+
+        num_sent += segments;
+    }
+
+    sself->used_buffers += num_sent;
+
+    return num_sent;
+}
+
+static inline NFV_SIMPLE_SIGNATURE(ssize_t, gro_recv, buffer_t buffers[],
+                                   size_t howmany) {
+    struct nfv_socket_simple *sself = (struct nfv_socket_simple *)(self);
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov;
+    struct msghdr msg;
+    size_t num_recv = 0;
+    size_t num_filled = 0;
+
+    while (num_recv < howmany) {
+        // Receive a new buffer when the current one is exhausted. Buffers
+        // filled in this same call must not be overwritten, since their
+        // payloads are handed to the application.
+        if (sself->gro_off >= sself->gro_len) {
+            size_t next = (sself->gro_cur + 1) % sself->gro_bufs_count;
+            ssize_t res;
+
+            if (num_filled == sself->gro_bufs_count - 1)
+                break;
+
+            iov.iov_base = sself->gro_bufs[next];
+            iov.iov_len = GRO_BUF_SIZE;
+
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            // Never wait for more datagrams when some are already available
+            res = recvmsg(sself->sock_fd, &msg,
+                          num_recv > 0 ? MSG_DONTWAIT : 0);
+            if (res <= 0)
+                break;
+
+            sself->gro_cur = next;
+            sself->gro_len = res;
+            sself->gro_seg = gro_segment_size(&msg, res);
+            sself->gro_off = 0;
+            ++num_filled;
+        }
+
+        byte_t *packet = sself->gro_bufs[sself->gro_cur] + sself->gro_off;
+        size_t len = sself->gro_len - sself->gro_off;
+
+        if (len > sself->gro_seg)
+            len = sself->gro_seg;
+
+        sself->gro_off += sself->gro_seg;
+
+        // Datagrams of unexpected size are discarded
+        if (unlikely(len != sself->used_size))
+            continue;
+
+        // Received payloads are sent back from where they are
+        sself->iovecs[num_recv].iov_base = packet;
+        buffers[num_recv] = packet;
+        ++num_recv;
+    }
+
+    sself->active_buffers = num_recv;
+
+    return num_recv;
+}
+
+/* ----------------------------- BUFFER ARENA ------------------------------ */
+
+/* The arena is sized as a multiple of this, as required by MAP_HUGETLB */
+#define ARENA_HUGEPAGE_SIZE (2UL << 20)
+
+/**
+ * Allocates the area holding all the buffers of a socket, in hugepages if
+ * possible and locked in memory if allowed.
+ *
+ * Pages are populated here by the thread owning the socket, which is already
+ * bound to its core, so that they are local to its NUMA node.
+ * */
+static inline byte_t *arena_alloc(size_t size) {
+    void *area;
+
+    size = RTE_ALIGN_CEIL(size, ARENA_HUGEPAGE_SIZE);
+
+    area = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1,
+                0);
+
+    // No hugepages available, regular pages will do
+    if (area == MAP_FAILED)
+        area = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+
+    if (area == MAP_FAILED) {
+        perror("SIMPLE ERROR: could not allocate buffers");
+        exit(EXIT_FAILURE);
+    }
+
+    // Not an error if RLIMIT_MEMLOCK is too low, pages are populated anyway
+    mlock(area, size);
+
+    return area;
+}
+
+/**
+ * Takes a buffer of the given size from the arena, starting on a new cache
+ * line so that no two buffers share one.
+ * */
+static inline byte_t *arena_take(byte_t **next, size_t size) {
+    byte_t *buffer = *next;
+    *next += RTE_ALIGN_CEIL(size, RTE_CACHE_LINE_SIZE);
+    return buffer;
+}
+
+/* ----------------------- CLASS FUNCTION DEFINITIONS ----------------------- */
+
 NFV_SIMPLE_SIGNATURE(void, init, config_ptr conf) {
     struct nfv_socket_simple *sself = (struct nfv_socket_simple *)(self);
 
@@ -21,8 +494,13 @@ NFV_SIMPLE_SIGNATURE(void, init, config_ptr conf) {
     sself->sock_fd = conf->sock_fd;
     sself->is_raw = (conf->sock_type & NFV_SOCK_RAW) != 0;
     sself->use_mmsg = conf->use_mmsg;
+    sself->ring = sself->is_raw ? conf->raw_ring : NULL;
     sself->used_size = sself->is_raw ? self->packet_size : self->payload_size;
     sself->base_offset = sself->is_raw ? OFFSET_PKT_PAYLOAD : 0;
+    self->frame_headroom = sself->is_raw ? PKT_HEADER_SIZE : 0;
+    sself->use_gso = conf->use_gso && !sself->is_raw;
+    sself->use_zerocopy = conf->use_zerocopy && !sself->is_raw;
+    sself->zc_outgoing = false;
 
     // Allocate all vectors of data
     sself->packets = malloc(sizeof(buffer_t) * self->burst_size);
@@ -31,24 +509,32 @@ NFV_SIMPLE_SIGNATURE(void, init, config_ptr conf) {
     sself->iovecs = calloc(self->burst_size, sizeof(struct iovec));
     sself->datagrams = calloc(self->burst_size, sizeof(struct mmsghdr));
 
-    // Allocate and initialize the entire memory area that will be used for data
-    // buffers
-    /*
-    byte_t *base_buffers_ptr =
-        calloc(self->burst_size * sself->used_size, sizeof(byte_t));
-        */
+    // All buffers are taken from a single memory area: packets used with the
+    // system calls, coalesced receive buffers and the zerocopy pool
+    size_t slot_size = RTE_ALIGN_CEIL(sself->used_size, RTE_CACHE_LINE_SIZE);
+    size_t zc_pool_size = ZC_POOL_BURSTS * self->burst_size;
+    size_t arena_size = 0;
+    byte_t *arena = NULL;
+
+    if (sself->ring == NULL)
+        arena_size += self->burst_size * slot_size;
+    if (sself->use_gso)
+        arena_size += (self->burst_size + 1) * GRO_BUF_SIZE;
+    if (sself->use_zerocopy)
+        arena_size += zc_pool_size * slot_size;
+    if (arena_size > 0)
+        arena = arena_alloc(arena_size);
 
     // Initialize all data structures
     for (size_t i = 0; i < self->burst_size; ++i) {
-        // Packets are all in a contiguous memory area allocated above, each
-        // separated by packet_size bytes
-        // NOTICE: ignoring alignment problems for now!
-        /*
-        sself->packets[i] =
-            base_buffers_ptr + (sizeof(byte_t) * sself->used_size) * i;
-            */
+        // In ring mode packets point inside the rings, see ring_recv and
+        // ring_request_out_buffers
+        if (sself->ring != NULL) {
+            sself->packets[i] = NULL;
+            continue;
+        }
 
-        sself->packets[i] = calloc(sself->used_size, sizeof(byte_t));
+        sself->packets[i] = arena_take(&arena, sself->used_size);
 
         // No scatter-gather I/O, all packet is in one piece
         // CHECKED: OK
@@ -77,6 +563,39 @@ NFV_SIMPLE_SIGNATURE(void, init, config_ptr conf) {
         }
     }
 
+    // One buffer more than the burst size, so that a burst can be split from
+    // the last buffer of the previous burst plus burst_size new buffers
+    if (sself->use_gso) {
+        sself->gro_bufs_count = self->burst_size + 1;
+        sself->gro_bufs = malloc(sizeof(byte_t *) * sself->gro_bufs_count);
+        for (size_t i = 0; i < sself->gro_bufs_count; ++i)
+            sself->gro_bufs[i] = arena_take(&arena, GRO_BUF_SIZE);
+
+        sself->gro_cur = 0;
+        sself->gro_len = 0;
+        sself->gro_seg = 0;
+        sself->gro_off = 0;
+    }
+
+    // Outgoing payloads come from a separate pool, while packets allocated
+    // above are used for reception only
+    if (sself->use_zerocopy) {
+        sself->zc_pool_size = zc_pool_size;
+        sself->zc_free = malloc(sizeof(byte_t *) * zc_pool_size);
+        sself->zc_inflight = malloc(sizeof(byte_t *) * zc_pool_size);
+        sself->zc_inflight_id = malloc(sizeof(uint32_t) * zc_pool_size);
+        sself->zc_completed = calloc(zc_pool_size, sizeof(bool));
+
+        for (size_t i = 0; i < zc_pool_size; ++i)
+            sself->zc_free[i] = arena_take(&arena, sself->used_size);
+
+        sself->zc_free_head = 0;
+        sself->zc_free_tail = zc_pool_size;
+        sself->zc_head = 0;
+        sself->zc_tail = 0;
+        sself->zc_next_id = 0;
+    }
+
     // For UDP sockets, the corresponding pair IP addr/UDP port is selected
     // automatically using connected sockets. For RAW sockets, we will build
     // a common header to be used by all packets.
@@ -85,7 +604,12 @@ NFV_SIMPLE_SIGNATURE(void, init, config_ptr conf) {
         pkt_hdr_setup(&sself->incoming_hdr, conf, DIR_INCOMING);
         pkt_hdr_setup(&sself->outgoing_hdr, conf, DIR_OUTGOING);
 
-        rte_memcpy(sself->frame_hdr, &sself->incoming_hdr,
+        // Each thread sends from a different source port, so that the flows
+        // of different threads are spread on the receiving side
+        hdr_offset_src_port(&sself->outgoing_hdr, conf->thread_id);
+        sself->nb_ports = conf->num_threads;
+
+        rte_memcpy(sself->frame_hdr, &sself->outgoing_hdr,
                    OFFSET_PKT_PAYLOAD - OFFSET_PKT_ETHER);
 
         /*
@@ -107,12 +631,12 @@ NFV_SIMPLE_SIGNATURE(void, init, config_ptr conf) {
         // time, to save some time later if possible
 
         // If using raw sockets, copy frame header into each packet
-        for (size_t i = 0; i < self->burst_size; ++i)
+        for (size_t i = 0; sself->ring == NULL && i < self->burst_size; ++i)
             rte_memcpy(sself->packets[i], sself->frame_hdr, PKT_HEADER_SIZE);
     }
 
     // Finally, initialize payload pointers in base class
-    for (size_t i = 0; i < self->burst_size; ++i)
+    for (size_t i = 0; sself->ring == NULL && i < self->burst_size; ++i)
         self->payloads[i] = sself->packets[i] + sself->base_offset;
 }
 
@@ -125,12 +649,24 @@ NFV_SIMPLE_SIGNATURE(size_t, request_out_buffers, buffer_t buffers[],
     if (unlikely(howmany > self->burst_size))
         howmany = self->burst_size;
 
+    if (sself->ring != NULL)
+        return nfv_socket_simple_ring_request_out_buffers(self, buffers,
+                                                          howmany);
+
+    if (sself->use_zerocopy)
+        return nfv_socket_simple_zc_request_out_buffers(self, buffers,
+                                                        howmany);
+
     // Implicit free of all previously acquired buffers
     sself->active_buffers = 0;
 
     for (size_t i = 0; i < howmany; ++i)
         buffers[i] = self->payloads[i];
 
+    // Vectors may point to received payloads after a send_back
+    for (size_t i = 0; sself->use_gso && i < howmany; ++i)
+        sself->iovecs[i].iov_base = self->payloads[i];
+
     sself->active_buffers += howmany;
     sself->used_buffers = 0;
 
@@ -141,11 +677,7 @@ NFV_SIMPLE_SIGNATURE(ssize_t, send, size_t howmany) {
     struct nfv_socket_simple *sself = (struct nfv_socket_simple *)(self);
 
     ssize_t num_sent;
-
-    byte_t base_buffers_ptr[sself->used_size * self->burst_size];
-
-    rte_memcpy(base_buffers_ptr, sself->packets[0],
-               sizeof(byte_t) * sself->used_size * self->burst_size);
+    int flags = sself->zc_outgoing ? MSG_ZEROCOPY : 0;
 
     if (unlikely(howmany > sself->active_buffers - sself->used_buffers))
         howmany = sself->active_buffers - sself->used_buffers;
@@ -153,22 +685,33 @@ NFV_SIMPLE_SIGNATURE(ssize_t, send, size_t howmany) {
     if (unlikely(howmany == 0))
         return 0;
 
+    if (sself->ring != NULL)
+        return nfv_socket_simple_ring_send(self, howmany);
+
+    if (sself->use_gso)
+        return nfv_socket_simple_gso_send(self, howmany);
+
     if (sself->use_mmsg) {
         // NOTICE: Assumes all sent messages are fully sent
-        num_sent =
-            sendmmsg(sself->sock_fd,
-                     sself->datagrams /* + sself->used_buffers */, howmany, 0);
+        num_sent = sendmmsg(sself->sock_fd,
+                            sself->datagrams + sself->used_buffers, howmany,
+                            flags);
     } else {
         for (num_sent = 0; ((size_t)(num_sent)) < howmany; ++num_sent) {
             ssize_t res = sendmsg(
                 sself->sock_fd,
-                &(sself->datagrams[num_sent + sself->used_buffers].msg_hdr), 0);
+                &(sself->datagrams[num_sent + sself->used_buffers].msg_hdr),
+                flags);
             if (res < 0 || ((size_t)(res)) != sself->used_size) {
                 break;
             }
         }
     }
 
+    // Each message sent is notified separately
+    for (ssize_t i = 0; sself->zc_outgoing && i < num_sent; ++i)
+        zc_track(sself, sself->used_buffers + i, 1);
+
     if (likely(num_sent > 0))
         sself->used_buffers += ((size_t)(num_sent));
 
@@ -185,10 +728,19 @@ NFV_SIMPLE_SIGNATURE(ssize_t, recv, byte_ptr_t *buffers, size_t howmany) {
     if (unlikely(howmany > self->burst_size))
         howmany = self->burst_size;
 
+    if (sself->ring != NULL)
+        return nfv_socket_simple_ring_recv(self, buffers, howmany);
+
+    if (sself->use_zerocopy)
+        nfv_socket_simple_zc_prepare_recv(self, howmany);
+
     // Implicit free of all previously acquired buffers
     sself->active_buffers = 0;
     sself->used_buffers = 0;
 
+    if (sself->use_gso)
+        return nfv_socket_simple_gro_recv(self, buffers, howmany);
+
     if (sself->use_mmsg) {
         // FIXME: Why should I repeat it each time???
         // for (auto i = decltype(burst_size){0}; i < burst_size; ++i)
@@ -221,7 +773,8 @@ NFV_SIMPLE_SIGNATURE(ssize_t, recv, byte_ptr_t *buffers, size_t howmany) {
                 const struct pkt_hdr *header =
                     (struct pkt_hdr *)sself->packets[i];
 
-                if (hdr_check_incoming(header, &sself->incoming_hdr)) {
+                if (hdr_check_incoming_ports(header, &sself->incoming_hdr,
+                                             sself->nb_ports)) {
                     // Packet was meant for this application!
                     sself->packets[num_recv_good] = sself->packets[i];
                     ++num_recv_good;
@@ -271,5 +824,9 @@ NFV_SIMPLE_SIGNATURE(ssize_t, send_back, size_t howmany) {
         }
     }
 
+    // Received packets live in the RX ring, they must be moved to the TX one
+    if (sself->ring != NULL)
+        howmany = nfv_socket_simple_ring_copy_to_tx(self, howmany);
+
     return nfv_socket_simple_send(self, howmany);
 }
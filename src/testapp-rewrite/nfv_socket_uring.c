@@ -0,0 +1,375 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "config.h"
+#include "constants.h"
+#include "nfv_socket_uring.h"
+
+/* ------------------------------- Constants -------------------------------- */
+
+/* Each buffer owned by the application and each operation submitted to the
+ * kernel is identified by a tag and an index, packed in a 64 bits value */
+#define URING_TAG_SHIFT 32
+#define URING_TAG_RECV 1ULL /* The multishot receive operation */
+#define URING_TAG_TX 2ULL   /* A TX slot, the index is the slot number */
+#define URING_TAG_RX 3ULL   /* A RX buffer, the index is the buffer id */
+
+/* Indexes of the registered (fixed) buffers */
+#define URING_BUF_TX 0
+#define URING_BUF_RX 1
+
+/* Group id of the provided buffer ring */
+#define URING_RX_BGID 0
+
+/* TX slots and RX buffers are allocated as a multiple of the burst size, so
+ * that the kernel can hold some bursts while the application fills others */
+#define URING_BURSTS_IN_FLIGHT 4
+#define URING_RX_MIN_BUFFERS 256
+#define URING_RX_MAX_BUFFERS 32768
+
+#define URING_SLOT_ALIGN 64
+
+/* ---------------------------- Private Functions --------------------------- */
+
+static inline uint64_t uring_tag(uint64_t tag, uint32_t idx) {
+    return (tag << URING_TAG_SHIFT) | idx;
+}
+
+static inline uint64_t uring_tag_get(uint64_t code) {
+    return code >> URING_TAG_SHIFT;
+}
+
+static inline uint32_t uring_tag_idx(uint64_t code) { return (uint32_t)code; }
+
+static inline byte_t *uring_tx_slot(struct nfv_socket_uring *sself,
+                                    uint32_t slot) {
+    return sself->tx_area + slot * sself->tx_slot_size;
+}
+
+static inline byte_t *uring_rx_buffer(struct nfv_socket_uring *sself,
+                                      uint32_t bid) {
+    return sself->rx_area + bid * sself->rx_slot_size;
+}
+
+/**
+ * Received payloads follow the header written by the multishot RECVMSG
+ * operation; no address nor control data are requested.
+ * */
+static inline byte_t *uring_rx_payload(struct nfv_socket_uring *sself,
+                                       uint32_t bid) {
+    return uring_rx_buffer(sself, bid) + sizeof(struct io_uring_recvmsg_out);
+}
+
+/**
+ * Gives a buffer back to the pool it belongs to. RX buffers become visible to
+ * the kernel only after a call to uring_buf_ring_advance with the number of
+ * returned buffers, accumulated in rx_returned.
+ * */
+static inline void uring_release(struct nfv_socket_uring *sself, uint64_t code,
+                                 uint16_t *rx_returned) {
+    uint32_t idx = uring_tag_idx(code);
+
+    if (uring_tag_get(code) == URING_TAG_TX) {
+        sself->tx_free[sself->tx_free_count++] = idx;
+    } else {
+        uring_buf_ring_add(&sself->rx_bufs, uring_rx_buffer(sself, idx),
+                           sself->rx_slot_size, idx, *rx_returned);
+        ++(*rx_returned);
+    }
+}
+
+/**
+ * Collects all the completed transmissions, giving their buffers back.
+ *
+ * NOTICE: failed transmissions are not distinguished from successful ones,
+ * much like datagrams dropped by the kernel after a successful send call.
+ * */
+static inline void uring_reap_tx(struct nfv_socket_uring *sself) {
+    struct uring *r = &sself->tx_ring;
+    uint32_t head;
+    uint32_t howmany;
+    uint16_t rx_returned = 0;
+
+    howmany = uring_cq_ready(r, &head);
+    if (howmany == 0 && unlikely(uring_needs_enter(r))) {
+        uring_submit(r);
+        howmany = uring_cq_ready(r, &head);
+    }
+
+    if (howmany == 0)
+        return;
+
+    for (uint32_t i = 0; i < howmany; ++i)
+        uring_release(sself, uring_cqe_at(r, head + i)->user_data,
+                      &rx_returned);
+
+    uring_cq_advance(r, howmany);
+
+    if (rx_returned)
+        uring_buf_ring_advance(&sself->rx_bufs, rx_returned);
+}
+
+/**
+ * Queues the multishot receive operation, which keeps posting one completion
+ * per datagram until the kernel terminates it (e.g. when it runs out of
+ * provided buffers).
+ * */
+static inline void uring_arm_recv(struct nfv_socket_uring *sself) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&sself->rx_ring);
+
+    if (unlikely(sqe == NULL))
+        return;
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = sself->sock_fd;
+    sqe->addr = (uint64_t)(uintptr_t)&sself->rx_msg;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = sself->rx_bufs.bgid;
+    sqe->user_data = uring_tag(URING_TAG_RECV, 0);
+
+    sself->rx_armed = true;
+}
+
+static inline void *uring_area_alloc(size_t size) {
+    void *area = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    return (area == MAP_FAILED) ? NULL : area;
+}
+
+static inline size_t uring_align(size_t size) {
+    return (size + URING_SLOT_ALIGN - 1) & ~((size_t)URING_SLOT_ALIGN - 1);
+}
+
+static inline void uring_init_fail(const char *msg) {
+    fprintf(stderr, "IO_URING ERROR: %s\n", msg);
+    exit(EXIT_FAILURE);
+}
+
+static inline NFV_URING_SIGNATURE(void, free_buffers) {
+    struct nfv_socket_uring *sself = (struct nfv_socket_uring *)(self);
+    uint16_t rx_returned = 0;
+
+    for (; unlikely(sself->used_buffers < sself->active_buffers);
+         ++sself->used_buffers) {
+        uring_release(sself, sself->buffers[sself->used_buffers],
+                      &rx_returned);
+    }
+
+    if (rx_returned)
+        uring_buf_ring_advance(&sself->rx_bufs, rx_returned);
+
+    sself->used_buffers = 0;
+    sself->active_buffers = 0;
+}
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+NFV_URING_SIGNATURE(void, init, config_ptr conf) {
+    struct nfv_socket_uring *sself = (struct nfv_socket_uring *)(self);
+    uint32_t rx_entries = URING_RX_MIN_BUFFERS;
+    struct iovec iovs[2];
+
+    sself->sock_fd = conf->sock_fd;
+    sself->active_buffers = 0;
+    sself->used_buffers = 0;
+
+    sself->tx_slots = URING_BURSTS_IN_FLIGHT * self->burst_size;
+    sself->tx_slot_size = uring_align(self->payload_size);
+
+    // The buffer ring size must be a power of two
+    while (rx_entries < URING_BURSTS_IN_FLIGHT * self->burst_size &&
+           rx_entries < URING_RX_MAX_BUFFERS)
+        rx_entries <<= 1;
+
+    sself->rx_slot_size = uring_align(sizeof(struct io_uring_recvmsg_out) +
+                                      self->payload_size);
+
+    sself->tx_area = uring_area_alloc(sself->tx_slots * sself->tx_slot_size);
+    sself->rx_area = uring_area_alloc(rx_entries * sself->rx_slot_size);
+    sself->tx_free = malloc(sizeof(uint32_t) * sself->tx_slots);
+    sself->buffers = malloc(sizeof(uint64_t) * self->burst_size);
+
+    if (sself->tx_area == NULL || sself->rx_area == NULL ||
+        sself->tx_free == NULL || sself->buffers == NULL)
+        uring_init_fail("could not allocate buffers");
+
+    // Lower slots are handed out first
+    for (uint32_t i = 0; i < sself->tx_slots; ++i)
+        sself->tx_free[i] = sself->tx_slots - i - 1;
+    sself->tx_free_count = sself->tx_slots;
+
+    // Each ring is used by the thread that owns this socket only
+    if (uring_init(&sself->tx_ring, sself->tx_slots) ||
+        uring_init(&sself->rx_ring, rx_entries))
+        uring_init_fail("could not create rings");
+
+    // Both areas are registered on the TX ring, since received payloads can
+    // be sent back as they are
+    iovs[URING_BUF_TX].iov_base = sself->tx_area;
+    iovs[URING_BUF_TX].iov_len = sself->tx_slots * sself->tx_slot_size;
+    iovs[URING_BUF_RX].iov_base = sself->rx_area;
+    iovs[URING_BUF_RX].iov_len = rx_entries * sself->rx_slot_size;
+
+    if (uring_register_buffers(&sself->tx_ring, iovs, 2))
+        uring_init_fail("could not register fixed buffers");
+
+    if (uring_buf_ring_init(&sself->rx_ring, &sself->rx_bufs, rx_entries,
+                            URING_RX_BGID))
+        uring_init_fail("could not provide reception buffers");
+
+    for (uint32_t i = 0; i < rx_entries; ++i)
+        uring_buf_ring_add(&sself->rx_bufs, uring_rx_buffer(sself, i),
+                           sself->rx_slot_size, i, i);
+    uring_buf_ring_advance(&sself->rx_bufs, rx_entries);
+
+    // The receive operation is armed by the first recv call, so that sockets
+    // used only for sending never consume incoming datagrams
+    memset(&sself->rx_msg, 0, sizeof(sself->rx_msg));
+    sself->rx_armed = false;
+}
+
+NFV_URING_SIGNATURE(size_t, request_out_buffers, buffer_t buffers[],
+                    size_t howmany) {
+    struct nfv_socket_uring *sself = (struct nfv_socket_uring *)(self);
+
+    if (unlikely(howmany > self->burst_size))
+        howmany = self->burst_size;
+
+    nfv_socket_uring_free_buffers(self);
+
+    // Slots become available again only after the kernel is done with them
+    uring_reap_tx(sself);
+
+    if (unlikely(howmany > sself->tx_free_count))
+        howmany = sself->tx_free_count;
+
+    for (size_t i = 0; i < howmany; ++i) {
+        uint32_t slot = sself->tx_free[--sself->tx_free_count];
+        sself->buffers[i] = uring_tag(URING_TAG_TX, slot);
+        buffers[i] = uring_tx_slot(sself, slot);
+    }
+
+    sself->active_buffers = howmany;
+
+    return howmany;
+}
+
+NFV_URING_SIGNATURE(ssize_t, send, size_t howmany) {
+    struct nfv_socket_uring *sself = (struct nfv_socket_uring *)(self);
+    size_t i;
+
+    if (unlikely(howmany > sself->active_buffers - sself->used_buffers))
+        howmany = sself->active_buffers - sself->used_buffers;
+
+    if (unlikely(howmany == 0))
+        return 0;
+
+    for (i = 0; i < howmany; ++i) {
+        uint64_t code = sself->buffers[sself->used_buffers + i];
+        uint32_t idx = uring_tag_idx(code);
+        struct io_uring_sqe *sqe = uring_get_sqe(&sself->tx_ring);
+
+        if (unlikely(sqe == NULL))
+            break;
+
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->fd = sself->sock_fd;
+        sqe->len = self->payload_size;
+        sqe->user_data = code;
+
+        if (uring_tag_get(code) == URING_TAG_TX) {
+            sqe->addr = (uint64_t)(uintptr_t)uring_tx_slot(sself, idx);
+            sqe->buf_index = URING_BUF_TX;
+        } else {
+            sqe->addr = (uint64_t)(uintptr_t)uring_rx_payload(sself, idx);
+            sqe->buf_index = URING_BUF_RX;
+        }
+    }
+
+    // The whole burst is submitted with a single system call. Should it fail,
+    // operations stay in the submission queue and are submitted by the next
+    // call, hence buffers are given to the kernel anyway.
+    uring_submit(&sself->tx_ring);
+
+    sself->used_buffers += i;
+
+    return i;
+}
+
+NFV_URING_SIGNATURE(ssize_t, recv, buffer_t buffers[], size_t howmany) {
+    struct nfv_socket_uring *sself = (struct nfv_socket_uring *)(self);
+    struct uring *r = &sself->rx_ring;
+    uint32_t head;
+    uint32_t ready;
+    uint32_t i;
+    size_t num_recv = 0;
+    uint16_t rx_returned = 0;
+
+    if (unlikely(howmany > self->burst_size))
+        howmany = self->burst_size;
+
+    nfv_socket_uring_free_buffers(self);
+
+    // Buffers that were sent back must go back to the buffer ring
+    uring_reap_tx(sself);
+
+    if (unlikely(!sself->rx_armed))
+        uring_arm_recv(sself);
+
+    // Enters the kernel only when needed, either to (re-)arm the receive
+    // operation or to have pending completions posted
+    uring_submit(r);
+
+    ready = uring_cq_ready(r, &head);
+
+    for (i = 0; i < ready && num_recv < howmany; ++i) {
+        const struct io_uring_cqe *cqe = uring_cqe_at(r, head + i);
+        const struct io_uring_recvmsg_out *out;
+        uint32_t bid;
+
+        if (!(cqe->flags & IORING_CQE_F_MORE))
+            sself->rx_armed = false;
+
+        if (unlikely(cqe->res < 0 || !(cqe->flags & IORING_CQE_F_BUFFER)))
+            continue;
+
+        bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        out = (struct io_uring_recvmsg_out *)uring_rx_buffer(sself, bid);
+
+        // Datagrams of unexpected size are discarded
+        if (unlikely(out->payloadlen != self->payload_size ||
+                     (out->flags & MSG_TRUNC))) {
+            uring_release(sself, uring_tag(URING_TAG_RX, bid), &rx_returned);
+            continue;
+        }
+
+        sself->buffers[num_recv] = uring_tag(URING_TAG_RX, bid);
+        buffers[num_recv] = uring_rx_payload(sself, bid);
+        ++num_recv;
+    }
+
+    uring_cq_advance(r, i);
+
+    if (rx_returned)
+        uring_buf_ring_advance(&sself->rx_bufs, rx_returned);
+
+    sself->active_buffers = num_recv;
+
+    return num_recv;
+}
+
+NFV_URING_SIGNATURE(ssize_t, send_back, size_t howmany) {
+    // The socket is connected to the remote host, so received payloads can be
+    // sent back directly from the buffers they were received in
+    return nfv_socket_uring_send(self, howmany);
+}
@@ -0,0 +1,250 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sys/socket.h>
+
+#include "config.h"
+#include "constants.h"
+#include "nfv_socket_xdp.h"
+
+static inline byte_t *xdp_frame_start(struct xdp_socket *xsk, uint64_t addr) {
+    return xsk->umem_area + addr;
+}
+
+static inline byte_t *xdp_payload(struct xdp_socket *xsk, uint64_t addr) {
+    return xdp_frame_start(xsk, addr) + OFFSET_PKT_PAYLOAD;
+}
+
+/**
+ * Returns the given reception frames to the kernel through the fill ring.
+ *
+ * NOTICE: the fill ring is as big as the number of reception frames, hence
+ * there is always room for all the frames that the application owns.
+ * */
+static inline void xdp_refill(struct xdp_socket *xsk, const uint64_t addrs[],
+                              uint32_t howmany) {
+    uint32_t idx;
+
+    if (howmany == 0)
+        return;
+
+    howmany = xdp_ring_reserve(&xsk->fill, howmany, &idx);
+    for (uint32_t i = 0; i < howmany; ++i)
+        *xdp_ring_addr(&xsk->fill, idx + i) = addrs[i];
+    xdp_ring_submit(&xsk->fill, howmany);
+}
+
+/**
+ * Gives a frame owned by the application back to the pool it belongs to.
+ * */
+static inline void xdp_release_frame(struct xdp_socket *xsk, uint64_t addr) {
+    if (xdp_is_rx_frame(addr))
+        xdp_refill(xsk, &addr, 1);
+    else
+        xsk->tx_frames[xsk->tx_frames_count++] = addr;
+}
+
+/**
+ * Collects all the frames whose transmission has been completed by the
+ * kernel.
+ * */
+static inline void xdp_reclaim(struct xdp_socket *xsk) {
+    uint32_t idx;
+    uint32_t howmany = xdp_ring_peek(&xsk->comp, XDP_RING_SIZE, &idx);
+
+    if (howmany == 0)
+        return;
+
+    for (uint32_t i = 0; i < howmany; ++i)
+        xdp_release_frame(xsk, *xdp_ring_addr(&xsk->comp, idx + i));
+
+    xdp_ring_release(&xsk->comp, howmany);
+}
+
+static inline NFV_XDP_SIGNATURE(void, free_buffers) {
+    struct nfv_socket_xdp *sself = (struct nfv_socket_xdp *)(self);
+    for (; unlikely(sself->used_buffers < sself->active_buffers);
+         ++sself->used_buffers) {
+        xdp_release_frame(sself->xsk, sself->frames[sself->used_buffers]);
+    }
+    sself->used_buffers = 0;
+    sself->active_buffers = 0;
+}
+
+static inline NFV_XDP_SIGNATURE(void, fill_buffer_array, buffer_t buffers[],
+                                size_t howmany) {
+    struct nfv_socket_xdp *sself = (struct nfv_socket_xdp *)(self);
+    for (size_t i = 0; i < howmany; ++i) {
+        buffers[i] = xdp_payload(sself->xsk, sself->frames[i]);
+    }
+}
+
+NFV_XDP_SIGNATURE(void, init, config_ptr conf) {
+    struct nfv_socket_xdp *sself = (struct nfv_socket_xdp *)(self);
+
+    sself->active_buffers = 0;
+    sself->used_buffers = 0;
+
+    sself->xsk = conf->xdp.xsk;
+    self->frame_headroom = PKT_HEADER_SIZE;
+
+    sself->frames = malloc(sizeof(uint64_t) * self->burst_size);
+    sself->recycled = malloc(sizeof(uint64_t) * self->burst_size);
+    if (sself->frames == NULL || sself->recycled == NULL) {
+        perror("XDP ERROR: could not allocate buffers");
+        free(sself->frames);
+        free(sself->recycled);
+        xdp_close(conf);
+        exit(EXIT_FAILURE);
+    }
+
+    // Setup packet headers, outgoing frames have their header already written
+    // by xdp_init
+    pkt_hdr_setup(&sself->incoming_hdr, conf, DIR_INCOMING);
+}
+
+NFV_XDP_SIGNATURE(size_t, request_out_buffers, buffer_t buffers[],
+                  size_t howmany) {
+    struct nfv_socket_xdp *sself = (struct nfv_socket_xdp *)(self);
+    struct xdp_socket *xsk = sself->xsk;
+
+    if (unlikely(howmany > self->burst_size))
+        howmany = self->burst_size;
+
+    nfv_socket_xdp_free_buffers(self);
+
+    // Frames become available again only after the kernel is done with them
+    xdp_reclaim(xsk);
+
+    if (unlikely(howmany > xsk->tx_frames_count))
+        howmany = xsk->tx_frames_count;
+
+    for (size_t i = 0; i < howmany; ++i)
+        sself->frames[i] = xsk->tx_frames[--xsk->tx_frames_count];
+
+    sself->active_buffers = howmany;
+    nfv_socket_xdp_fill_buffer_array(self, buffers, howmany);
+
+    return howmany;
+}
+
+NFV_XDP_SIGNATURE(ssize_t, send, size_t howmany) {
+    struct nfv_socket_xdp *sself = (struct nfv_socket_xdp *)(self);
+    struct xdp_socket *xsk = sself->xsk;
+    uint32_t idx;
+    uint32_t num_sent;
+
+    if (unlikely(howmany > sself->active_buffers - sself->used_buffers))
+        howmany = sself->active_buffers - sself->used_buffers;
+
+    if (unlikely(howmany == 0))
+        return 0;
+
+    num_sent = xdp_ring_reserve(&xsk->tx, howmany, &idx);
+
+    for (uint32_t i = 0; i < num_sent; ++i) {
+        struct xdp_desc *desc = xdp_ring_desc(&xsk->tx, idx + i);
+        desc->addr = sself->frames[sself->used_buffers + i];
+        desc->len = self->packet_size;
+        desc->options = 0;
+    }
+
+    xdp_ring_submit(&xsk->tx, num_sent);
+
+    // In copy mode (or when the driver asks for it) the kernel must be kicked
+    // to actually start the transmission
+    if (!xsk->need_wakeup || xdp_ring_needs_wakeup(&xsk->tx))
+        sendto(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+
+    if (likely(num_sent > 0))
+        sself->used_buffers += num_sent;
+
+    return num_sent;
+}
+
+NFV_XDP_SIGNATURE(ssize_t, recv, buffer_t buffers[], size_t howmany) {
+    struct nfv_socket_xdp *sself = (struct nfv_socket_xdp *)(self);
+    struct xdp_socket *xsk = sself->xsk;
+    uint32_t idx;
+    uint32_t num_recv;
+    uint32_t num_recv_good = 0;
+    uint32_t num_recycled = 0;
+
+    if (unlikely(howmany > self->burst_size))
+        howmany = self->burst_size;
+
+    nfv_socket_xdp_free_buffers(self);
+
+    if (xsk->need_wakeup && xdp_ring_needs_wakeup(&xsk->fill))
+        recvfrom(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+
+    num_recv = xdp_ring_peek(&xsk->rx, howmany, &idx);
+
+    // I put a "likely" here to prefer scenarios in which there is actually
+    // something to do with the incoming packets.
+    if (likely(num_recv > 0)) {
+        // Filter-out packets NOT meant for this application
+        for (uint32_t i = 0; i < num_recv; ++i) {
+            const struct xdp_desc *desc = xdp_ring_desc(&xsk->rx, idx + i);
+            const struct pkt_hdr *header =
+                (struct pkt_hdr *)xdp_frame_start(xsk, desc->addr);
+
+            if (hdr_check_incoming(header, &sself->incoming_hdr)) {
+                // Packet was meant for this application!
+                sself->frames[num_recv_good] = desc->addr;
+                ++num_recv_good;
+            } else {
+                // Give this frame back to the kernel
+                sself->recycled[num_recycled] = desc->addr;
+                ++num_recycled;
+            }
+        }
+
+        xdp_ring_release(&xsk->rx, num_recv);
+        xdp_refill(xsk, sself->recycled, num_recycled);
+
+        sself->active_buffers += num_recv_good;
+    }
+
+    nfv_socket_xdp_fill_buffer_array(self, buffers, num_recv_good);
+
+    return num_recv_good;
+}
+
+NFV_XDP_SIGNATURE(ssize_t, send_back, size_t howmany) {
+    struct nfv_socket_xdp *sself = (struct nfv_socket_xdp *)(self);
+
+    if (unlikely(howmany > sself->active_buffers - sself->used_buffers))
+        howmany = sself->active_buffers - sself->used_buffers;
+
+    if (unlikely(howmany == 0))
+        return 0;
+
+    struct rte_ipv4_hdr *ip_hdr;
+
+    for (size_t i = 0; i < howmany; ++i) {
+        size_t j = i + sself->used_buffers;
+
+        byte_t *packet_start = xdp_frame_start(sself->xsk, sself->frames[j]);
+
+        swap_ether_addr(
+            (struct rte_ether_hdr *)(packet_start + OFFSET_PKT_ETHER));
+        swap_ipv4_addr((struct rte_ipv4_hdr *)(packet_start + OFFSET_PKT_IPV4));
+        swap_udp_port((struct rte_udp_hdr *)(packet_start + OFFSET_PKT_UDP));
+
+        // Calculate ip_hdr new checksum
+        ip_hdr = (struct rte_ipv4_hdr *)(packet_start + OFFSET_PKT_IPV4);
+        ip_hdr->hdr_checksum = 0;
+        ip_hdr->hdr_checksum = rte_ipv4_cksum(ip_hdr);
+    }
+
+    // Sent back frames return to the fill ring once their transmission is
+    // completed, see xdp_reclaim
+    xdp_reclaim(sself->xsk);
+
+    return nfv_socket_xdp_send(self, howmany);
+}
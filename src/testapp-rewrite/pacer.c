@@ -0,0 +1,253 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pacer.h"
+
+/* ------------------------------- Constants -------------------------------- */
+
+#define PRINT_PACER_ERROR(str) perror("PACER ERROR: " str)
+
+#define NSEC_PER_SEC 1000000000ULL
+#define USEC_PER_SEC 1000000ULL
+
+/* Initial number of gaps allocated for a trace, doubled when needed */
+#define PACER_TRACE_INITIAL 4096
+
+/* --------------------------- Private Functions ---------------------------- */
+
+/**
+ * Fills the given table with exponentially distributed gaps with the given
+ * mean, so that drawing a uniformly random entry draws an exponential gap.
+ * Entries are the quantiles of evenly spaced probabilities, rounded so that
+ * their sum is exactly the one of PACER_TABLE_SIZE mean gaps and the long-run
+ * rate does not drift.
+ * */
+static void pacer_exp_table(tsc_t *deltas, double mean) {
+    double scale = 0, cum = 0;
+    tsc_t prev = 0, cur;
+
+    for (size_t i = 0; i < PACER_TABLE_SIZE; ++i)
+        scale -= log1p(-(i + 0.5) / PACER_TABLE_SIZE);
+
+    scale = mean * PACER_TABLE_SIZE / scale;
+
+    for (size_t i = 0; i < PACER_TABLE_SIZE; ++i) {
+        cum -= log1p(-(i + 0.5) / PACER_TABLE_SIZE) * scale;
+        cur = llround(cum);
+        deltas[i] = cur - prev;
+        prev = cur;
+    }
+}
+
+/**
+ * Parses a line of a trace file, ignoring empty lines and comments.
+ *
+ * \return 1 if a gap was read, 0 if the line holds none, -1 on errors.
+ * */
+static inline int pacer_trace_line(const char *line, double *ns) {
+    char *end;
+
+    line += strspn(line, " \t");
+    if (*line == '\0' || *line == '\n' || *line == '#')
+        return 0;
+
+    *ns = strtod(line, &end);
+    if (end == line || *ns < 0)
+        return -1;
+
+    return 1;
+}
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+/**
+ * Loads the gaps of the trace profile given in the configuration, one gap in
+ * nanoseconds per line of a text file, converting them to TSC cycles. Does
+ * nothing if another profile is selected.
+ *
+ * Shall be invoked after tsc_init.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+int pacer_trace_init(struct config *conf) {
+    const tsc_t tsc_hz = tsc_get_hz();
+    struct pacer_trace *trace;
+    size_t allocated = PACER_TRACE_INITIAL;
+    tsc_t *deltas;
+    char *line = NULL;
+    size_t line_size = 0;
+    unsigned long lineno = 0;
+    double ns;
+    FILE *file;
+    int res;
+
+    if (conf->pacer.profile != PACER_PROFILE_TRACE)
+        return 0;
+
+    file = fopen(conf->pacer.trace_path, "r");
+    if (file == NULL) {
+        PRINT_PACER_ERROR("could not open trace file");
+        return -1;
+    }
+
+    trace = calloc(1, sizeof(*trace));
+    if (trace == NULL) {
+        PRINT_PACER_ERROR("could not allocate trace");
+        goto error_close;
+    }
+
+    trace->deltas = malloc(sizeof(tsc_t) * allocated);
+    if (trace->deltas == NULL) {
+        PRINT_PACER_ERROR("could not allocate trace");
+        goto error_free;
+    }
+
+    while (getline(&line, &line_size, file) > 0) {
+        ++lineno;
+
+        res = pacer_trace_line(line, &ns);
+        if (res < 0) {
+            fprintf(stderr, "PACER ERROR: invalid gap at line %lu of %s\n",
+                    lineno, conf->pacer.trace_path);
+            goto error_free;
+        }
+        if (res == 0)
+            continue;
+
+        if (trace->nb_deltas == allocated) {
+            allocated *= 2;
+            deltas = realloc(trace->deltas, sizeof(tsc_t) * allocated);
+            if (deltas == NULL) {
+                PRINT_PACER_ERROR("could not allocate trace");
+                goto error_free;
+            }
+            trace->deltas = deltas;
+        }
+
+        trace->deltas[trace->nb_deltas++] = llround(ns * tsc_hz / NSEC_PER_SEC);
+    }
+
+    if (trace->nb_deltas == 0) {
+        fprintf(stderr, "PACER ERROR: trace file contains no gaps\n");
+        goto error_free;
+    }
+
+    free(line);
+    fclose(file);
+
+    printf("Loaded %lu gaps from %s\n", trace->nb_deltas,
+           conf->pacer.trace_path);
+
+    conf->pacer.trace = trace;
+    return 0;
+
+error_free:
+    free(line);
+    free(trace->deltas);
+    free(trace);
+error_close:
+    fclose(file);
+    return -1;
+}
+
+/**
+ * Initializes the schedule of a thread sending at the configured rate and
+ * profile, with the first departure at the given time.
+ *
+ * Shall be invoked by the thread using the schedule, so that the tables it
+ * draws gaps from are allocated close to it. Exits on failure, since sending
+ * loops have no way to report it.
+ * */
+void pacer_init(struct pacer *pacer, const struct config *conf,
+                tsc_t tsc_start) {
+    memset(pacer, 0, sizeof(*pacer));
+
+    pacer->profile = conf->pacer.profile;
+    pacer->burst_size = conf->bst_size;
+    pacer->spacing = conf->pacer.spacing;
+    pacer->catchup = conf->pacer.catchup;
+
+    switch (pacer->profile) {
+    case PACER_PROFILE_POISSON:
+        pacer->table = malloc(sizeof(tsc_t) * PACER_TABLE_SIZE);
+        if (pacer->table == NULL) {
+            PRINT_PACER_ERROR("could not allocate gaps");
+            exit(EXIT_FAILURE);
+        }
+
+        pacer->deltas = pacer->table;
+        pacer->nb_deltas = PACER_TABLE_SIZE;
+
+        // Threads starting together shall not draw the same gaps
+        pacer->prng = tsc_start + (conf->thread_id + 1) * 0x9E3779B97F4A7C15ULL;
+        if (pacer->prng == 0)
+            pacer->prng = 1;
+        break;
+    case PACER_PROFILE_TRACE:
+        pacer->deltas = conf->pacer.trace->deltas;
+        pacer->nb_deltas = conf->pacer.trace->nb_deltas;
+        break;
+    default:
+        break;
+    }
+
+    pacer_set_rate(pacer, conf, conf->rate, tsc_start);
+}
+
+/**
+ * Changes the average rate of the schedule, restarting it with the next
+ * departure at the given time. Gaps read from traces are not affected.
+ * */
+void pacer_set_rate(struct pacer *pacer, const struct config *conf,
+                    rate_t rate, tsc_t tsc_start) {
+    const tsc_t tsc_hz = tsc_get_hz();
+    const tsc_t tsc_burst = tsc_hz * conf->bst_size / rate;
+    const size_t unit = conf->pacer.spacing ? 1 : conf->bst_size;
+    uint64_t num = tsc_hz * unit;
+
+    pacer->tsc_next = tsc_start;
+    pacer->frac = 0;
+    pacer->gap_den = rate;
+
+    switch (pacer->profile) {
+    case PACER_PROFILE_POISSON:
+        pacer_exp_table(pacer->table, (double)num / rate);
+        break;
+    case PACER_PROFILE_ONOFF:
+        pacer->tsc_on = tsc_hz * conf->pacer.on_us / USEC_PER_SEC;
+        pacer->tsc_off = tsc_hz * conf->pacer.off_us / USEC_PER_SEC;
+        pacer->tsc_on_end = tsc_start + pacer->tsc_on;
+
+        // Departures are closer in on phases, so that the average rate is
+        // still the configured one
+        num *= conf->pacer.on_us;
+        pacer->gap_den *= conf->pacer.on_us + conf->pacer.off_us;
+        break;
+    default:
+        break;
+    }
+
+    pacer->gap = num / pacer->gap_den;
+    pacer->gap_frac = num % pacer->gap_den;
+
+    // Being late by less than a burst is just jitter of the loop
+    switch (pacer->catchup) {
+    case PACER_CATCHUP_SKIP:
+        pacer->tsc_max_lag = tsc_burst;
+        break;
+    case PACER_CATCHUP_CAP:
+        pacer->tsc_max_lag = tsc_burst * PACER_CAP_BURSTS;
+        break;
+    default:
+        pacer->tsc_max_lag = UINT64_MAX;
+        break;
+    }
+}
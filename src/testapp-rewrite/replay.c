@@ -0,0 +1,307 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <byteswap.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+
+#include "constants.h"
+#include "pcap.h"
+#include "replay.h"
+
+/* ------------------------------- Constants -------------------------------- */
+
+#define PRINT_REPLAY_ERROR(str) perror("REPLAY ERROR: " str)
+
+#define NSEC_PER_SEC 1000000000ULL
+
+/* The area of non-DPDK applications is sized as a multiple of this, as
+ * required by MAP_HUGETLB */
+#define REPLAY_HUGEPAGE_SIZE (2UL << 20)
+
+/* ---------------------------- Type definitions ---------------------------- */
+
+/**
+ * A pcap file mapped in memory, with the information needed to parse it.
+ * */
+struct pcap_file {
+    const byte_t *data;
+    size_t size;
+    bool swapped; /* Whether fields are in the opposite byte order */
+    bool nsec;    /* Whether timestamps are in nanoseconds */
+};
+
+/* --------------------------- Private Functions ---------------------------- */
+
+static inline uint32_t pcap_u32(const struct pcap_file *file, uint32_t v) {
+    return file->swapped ? bswap_32(v) : v;
+}
+
+/**
+ * Parses the record starting at the given offset of the file.
+ *
+ * \return the offset of the next record, 0 if the record is truncated.
+ * */
+static inline size_t pcap_record(const struct pcap_file *file, size_t offset,
+                                 uint64_t *ns, const byte_t **frame,
+                                 uint32_t *caplen) {
+    struct pcap_rec_hdr rec;
+
+    if (offset + sizeof(rec) > file->size)
+        return 0;
+
+    memcpy(&rec, file->data + offset, sizeof(rec));
+    offset += sizeof(rec);
+
+    *caplen = pcap_u32(file, rec.caplen);
+    if (offset + *caplen > file->size)
+        return 0;
+
+    *ns = pcap_u32(file, rec.ts_sec) * NSEC_PER_SEC +
+          pcap_u32(file, rec.ts_nsec) * (file->nsec ? 1 : 1000);
+    *frame = file->data + offset;
+
+    return offset + *caplen;
+}
+
+/**
+ * Copies in dst the payload of the given Ethernet frame, i.e. the UDP payload
+ * of IPv4/UDP packets and the whole Ethernet payload of any other packet,
+ * truncated or padded with zeros to size bytes.
+ * */
+static inline void pcap_payload(byte_t *dst, size_t size, const byte_t *frame,
+                                uint32_t caplen) {
+    const struct rte_ether_hdr *eth = (const struct rte_ether_hdr *)frame;
+    const struct rte_ipv4_hdr *ip;
+    size_t offset = sizeof(struct rte_ether_hdr);
+    size_t ihl;
+
+    if (caplen >= offset + sizeof(struct rte_ipv4_hdr) &&
+        eth->ether_type == rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4)) {
+        ip = (const struct rte_ipv4_hdr *)(frame + offset);
+        ihl = (ip->version_ihl & 0x0F) * 4;
+
+        if (ip->next_proto_id == IPPROTO_UDP &&
+            caplen >= offset + ihl + sizeof(struct rte_udp_hdr))
+            offset += ihl + sizeof(struct rte_udp_hdr);
+    }
+
+    memset(dst, 0, size);
+    if (caplen > offset)
+        memcpy(dst, frame + offset, RTE_MIN(size, caplen - offset));
+}
+
+/**
+ * Maps the given pcap file and checks its header.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+static int pcap_open(const char *path, struct pcap_file *file) {
+    struct pcap_file_hdr hdr;
+    struct stat st;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        PRINT_REPLAY_ERROR("could not open pcap file");
+        return -1;
+    }
+
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(hdr)) {
+        fprintf(stderr, "REPLAY ERROR: pcap file is too small\n");
+        close(fd);
+        return -1;
+    }
+
+    file->size = st.st_size;
+    file->data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (file->data == MAP_FAILED) {
+        PRINT_REPLAY_ERROR("could not map pcap file");
+        return -1;
+    }
+
+    memcpy(&hdr, file->data, sizeof(hdr));
+
+    switch (hdr.magic) {
+    case PCAP_MAGIC_USEC:
+    case PCAP_MAGIC_NSEC:
+        file->swapped = false;
+        break;
+    default:
+        file->swapped = true;
+        hdr.magic = bswap_32(hdr.magic);
+        break;
+    }
+
+    file->nsec = hdr.magic == PCAP_MAGIC_NSEC;
+
+    if (hdr.magic != PCAP_MAGIC_USEC && hdr.magic != PCAP_MAGIC_NSEC) {
+        fprintf(stderr, "REPLAY ERROR: not a pcap file (pcapng is not "
+                        "supported)\n");
+        goto error;
+    }
+
+    if (pcap_u32(file, hdr.linktype) != PCAP_LINKTYPE_ETHERNET) {
+        fprintf(stderr, "REPLAY ERROR: only Ethernet captures are "
+                        "supported\n");
+        goto error;
+    }
+
+    return 0;
+
+error:
+    munmap((void *)file->data, file->size);
+    return -1;
+}
+
+/**
+ * Allocates the area holding all the payloads of the trace, in hugepages if
+ * possible.
+ * */
+static byte_t *replay_area_alloc(struct replay *replay, struct config *conf) {
+    void *area;
+
+    replay->area_dpdk = USE_DPDK(conf);
+
+    if (replay->area_dpdk) {
+        replay->area_size = replay->nb_pkts * replay->payload_size;
+        return rte_malloc_socket("replay", replay->area_size,
+                                 RTE_CACHE_LINE_SIZE, rte_socket_id());
+    }
+
+    replay->area_size = (replay->nb_pkts * replay->payload_size +
+                         REPLAY_HUGEPAGE_SIZE - 1) &
+                        ~(REPLAY_HUGEPAGE_SIZE - 1);
+
+    area = mmap(NULL, replay->area_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1,
+                0);
+    if (area != MAP_FAILED)
+        return area;
+
+    // No hugepages available, regular pages will do
+    area = mmap(NULL, replay->area_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    return (area == MAP_FAILED) ? NULL : area;
+}
+
+static void replay_area_free(struct replay *replay) {
+    if (replay->area_dpdk)
+        rte_free(replay->payloads);
+    else
+        munmap(replay->payloads, replay->area_size);
+}
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+/**
+ * Preloads in memory the pcap file given in the configuration, so that it can
+ * be replayed by send loops. Does nothing if replay is not enabled.
+ *
+ * Shall be invoked after tsc_init and (for DPDK) after dpdk_init.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+int replay_init(struct config *conf) {
+    struct replay *replay;
+    struct pcap_file file;
+    const byte_t *frame = NULL;
+    uint32_t caplen = 0;
+    uint64_t ns = 0, ns_first = 0, ns_last = 0;
+    size_t offset, i;
+    tsc_t tsc_hz;
+
+    if (conf->replay.path == NULL)
+        return 0;
+
+    if (pcap_open(conf->replay.path, &file))
+        return -1;
+
+    replay = calloc(1, sizeof(*replay));
+    if (replay == NULL) {
+        PRINT_REPLAY_ERROR("could not allocate replay");
+        goto error_unmap;
+    }
+
+    replay->payload_size = conf->payload_size;
+
+    // First pass, count packets
+    offset = sizeof(struct pcap_file_hdr);
+    while ((offset = pcap_record(&file, offset, &ns, &frame, &caplen)) != 0)
+        ++replay->nb_pkts;
+
+    if (replay->nb_pkts == 0) {
+        fprintf(stderr, "REPLAY ERROR: pcap file contains no packets\n");
+        goto error_free;
+    }
+
+    replay->tsc_offsets = malloc(sizeof(tsc_t) * replay->nb_pkts);
+    replay->payloads = replay_area_alloc(replay, conf);
+    if (replay->tsc_offsets == NULL || replay->payloads == NULL) {
+        PRINT_REPLAY_ERROR("could not allocate trace");
+        goto error_free;
+    }
+
+    // Second pass, copy payloads and compute departure times
+    tsc_hz = tsc_get_hz();
+    offset = sizeof(struct pcap_file_hdr);
+    for (i = 0; i < replay->nb_pkts; ++i) {
+        offset = pcap_record(&file, offset, &ns, &frame, &caplen);
+
+        if (i == 0)
+            ns_first = ns;
+
+        // Out-of-order timestamps are sent right after the previous packet
+        ns_last = RTE_MAX(ns, ns_last);
+        ns = ns_last - ns_first;
+
+        replay->tsc_offsets[i] = (ns / NSEC_PER_SEC) * tsc_hz +
+                                 (ns % NSEC_PER_SEC) * tsc_hz / NSEC_PER_SEC;
+
+        pcap_payload(replay->payloads + i * replay->payload_size,
+                     replay->payload_size, frame, caplen);
+    }
+
+    // The next pass starts after the average gap between packets
+    replay->tsc_period = replay->tsc_offsets[replay->nb_pkts - 1];
+    if (replay->nb_pkts > 1)
+        replay->tsc_period += replay->tsc_period / (replay->nb_pkts - 1);
+
+    // Traces with no gaps at all (e.g. a single packet) would be sent over
+    // and over without pause: passes are spaced so that the configured rate
+    // is kept on average instead
+    if (replay->tsc_period == 0)
+        replay->tsc_period =
+            RTE_MAX(tsc_hz * replay->nb_pkts / conf->rate, (tsc_t)1);
+
+    munmap((void *)file.data, file.size);
+
+    printf("Loaded %lu packets from %s\n", replay->nb_pkts,
+           conf->replay.path);
+
+    conf->replay.replay = replay;
+    return 0;
+
+error_free:
+    if (replay->payloads != NULL)
+        replay_area_free(replay);
+    free(replay->tsc_offsets);
+    free(replay);
+error_unmap:
+    munmap((void *)file.data, file.size);
+    return -1;
+}
@@ -0,0 +1,556 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <rte_common.h>
+
+#include "search.h"
+#include "timestamp.h"
+
+/* ------------------------------- Constants -------------------------------- */
+
+#define PRINT_SEARCH_ERROR(str) perror("SEARCH ERROR: " str)
+
+#define NSEC_PER_SEC 1000000000ULL
+#define NSEC_PER_MSEC 1000000ULL
+#define USEC_PER_SEC 1000000ULL
+
+/* The search stops when the highest rate known to pass and the lowest one
+ * known to fail are closer than this fraction of the maximum rate */
+#define SEARCH_RESOLUTION 0.001
+
+/* Maximum number of trials of a search, more than enough for the resolution
+ * above */
+#define SEARCH_MAX_TRIALS 32
+
+/* Time waited after each trial, so that packets still in flight are counted
+ * by the receiver [ms] */
+#define SEARCH_DRAIN_MS 100
+
+/* Attempts to connect to the receiver, one per second */
+#define SEARCH_CONNECT_ATTEMPTS 30
+
+/* Length of the longest message of the control channel */
+#define SEARCH_LINE_SIZE 64
+
+/* ---------------------------- Type definitions ---------------------------- */
+
+/**
+ * The outcome of a single trial of the search.
+ * */
+struct search_trial {
+    rate_t rate; /* Per-thread rate [pps] */
+    uint64_t tx; /* Packets sent by all threads */
+    uint64_t rx; /* Packets received by the other application, or replies
+                    received in time by the client */
+    double loss; /* Fraction of packets lost */
+    double delay_us; /* Configured percentile of round-trip delays [us]
+                        (latency search only) */
+    bool pass;
+};
+
+/* --------------------------- Private Functions ---------------------------- */
+
+/**
+ * Parses a control channel address, in the form <ip>:<port>.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+static int search_addr_parse(const char *str, struct sockaddr_in *addr) {
+    char ip[INET_ADDRSTRLEN];
+    const char *colon = strrchr(str, ':');
+    char *end;
+    unsigned long port;
+
+    if (colon == NULL || (size_t)(colon - str) >= sizeof(ip))
+        return -1;
+
+    memcpy(ip, str, colon - str);
+    ip[colon - str] = '\0';
+
+    port = strtoul(colon + 1, &end, 10);
+    if (*end != '\0' || port == 0 || port > UINT16_MAX)
+        return -1;
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+
+    return inet_aton(ip, &addr->sin_addr) ? 0 : -1;
+}
+
+static void search_sleep_ms(unsigned int ms) {
+    struct timespec ts = {
+        .tv_sec = ms / 1000,
+        .tv_nsec = (ms % 1000) * NSEC_PER_MSEC,
+    };
+
+    while (nanosleep(&ts, &ts) && errno == EINTR)
+        ;
+}
+
+/**
+ * Returns the packets counted so far by all the threads in the given slots.
+ * */
+static uint64_t search_total(const struct search_slot slots[],
+                             unsigned int nb_slots) {
+    uint64_t total = 0;
+
+    for (unsigned int i = 0; i < nb_slots; ++i)
+        total += __atomic_load_n(&slots[i].count, __ATOMIC_ACQUIRE);
+
+    return total;
+}
+
+static void search_wait(const struct search_slot slots[],
+                        unsigned int nb_slots, uint64_t epoch) {
+    for (unsigned int i = 0; i < nb_slots; ++i) {
+        while (__atomic_load_n(&slots[i].epoch, __ATOMIC_ACQUIRE) != epoch)
+            usleep(10);
+    }
+}
+
+/**
+ * Changes the rate of all sending threads (0 to pause them) and waits until
+ * all polling threads applied it.
+ * */
+static void search_set_rate(struct search *search, rate_t rate) {
+    const uint64_t epoch = search->epoch + 1;
+
+    search->rate = rate;
+    __atomic_store_n(&search->epoch, epoch, __ATOMIC_RELEASE);
+
+    if (search->senders)
+        search_wait(search->tx, search->nb_slots, epoch);
+
+    if (search->latency)
+        search_wait(search->rx, search->nb_slots, epoch);
+}
+
+/**
+ * Collects the round-trip delays measured by all client threads during the
+ * last trial.
+ * */
+static void search_delays(struct config *conf, struct search *search,
+                          struct search_trial *trial) {
+    struct histogram delays;
+
+    // Replies still in flight were received during the drain time: once all
+    // client threads stopped recording, their delays are read here and left
+    // alone, each thread resets its own ones when the next trial starts
+    search->record = false;
+    search_set_rate(search, 0);
+
+    histogram_reset(&delays);
+    for (unsigned int i = 0; i < search->nb_slots; ++i)
+        histogram_merge(&delays, search->rx[i].delays);
+
+    trial->rx = delays.total;
+    trial->delay_us =
+        (double)histogram_percentile(&delays, conf->search.percentile) *
+        USEC_PER_SEC / tsc_get_hz();
+}
+
+/**
+ * Sends a request on the control channel and reads the reply, exiting on
+ * failure since the search cannot go on without the receiver.
+ * */
+static void search_request(struct search *search, FILE *in, const char *req,
+                           char *reply) {
+    if (dprintf(search->fd, "%s\n", req) < 0 ||
+        fgets(reply, SEARCH_LINE_SIZE, in) == NULL) {
+        fprintf(stderr, "SEARCH ERROR: control channel closed\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Connects to the control channel of the receiver, which may not have been
+ * started yet.
+ *
+ * \return the stream replies are read from.
+ * */
+static FILE *search_connect(struct search *search) {
+    const int one = 1;
+    int attempts = SEARCH_CONNECT_ATTEMPTS;
+    FILE *in;
+
+    for (;;) {
+        search->fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (search->fd < 0) {
+            PRINT_SEARCH_ERROR("could not create control socket");
+            exit(EXIT_FAILURE);
+        }
+
+        if (connect(search->fd, (struct sockaddr *)&search->addr,
+                    sizeof(search->addr)) == 0)
+            break;
+
+        if (--attempts == 0) {
+            PRINT_SEARCH_ERROR("could not connect to the receiver");
+            exit(EXIT_FAILURE);
+        }
+
+        close(search->fd);
+        search_sleep_ms(1000);
+    }
+
+    // Requests are small and latency matters more than throughput
+    setsockopt(search->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    in = fdopen(search->fd, "r");
+    if (in == NULL) {
+        PRINT_SEARCH_ERROR("could not open control channel");
+        exit(EXIT_FAILURE);
+    }
+
+    return in;
+}
+
+/**
+ * Runs a trial at the rate given in it: the receiver (or the client itself)
+ * counts the packets it gets between the start and the end of the trial,
+ * which happen while all sending threads are paused.
+ * */
+static void search_trial_run(struct config *conf, struct search *search,
+                             FILE *in, struct search_trial *trial) {
+    char reply[SEARCH_LINE_SIZE];
+    uint64_t tx = search_total(search->tx, search->nb_slots);
+
+    if (!search->latency) {
+        search_request(search, in, "START", reply);
+        if (strcmp(reply, "OK\n") != 0) {
+            fprintf(stderr, "SEARCH ERROR: unexpected reply %s", reply);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    search->record = search->latency;
+    search->tsc_start = tsc_read();
+    search_set_rate(search, trial->rate);
+    search_sleep_ms(conf->search.trial_ms);
+    search_set_rate(search, 0);
+
+    trial->tx = search_total(search->tx, search->nb_slots) - tx;
+
+    search_sleep_ms(SEARCH_DRAIN_MS);
+
+    if (search->latency) {
+        search_delays(conf, search, trial);
+    } else {
+        search_request(search, in, "STOP", reply);
+        if (sscanf(reply, "RX %lu", &trial->rx) != 1) {
+            fprintf(stderr, "SEARCH ERROR: unexpected reply %s", reply);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Nothing sent is nothing proven; stray packets are not losses
+    if (trial->tx == 0)
+        trial->loss = 1;
+    else if (trial->rx >= trial->tx)
+        trial->loss = 0;
+    else
+        trial->loss = (double)(trial->tx - trial->rx) / trial->tx;
+
+    trial->pass = trial->loss <= conf->search.max_loss;
+    if (search->latency)
+        trial->pass &= trial->delay_us <= conf->search.max_delay_us;
+}
+
+static int search_trial_cmp(const void *a, const void *b) {
+    const struct search_trial *ta = a, *tb = b;
+
+    return (ta->rate > tb->rate) - (ta->rate < tb->rate);
+}
+
+/**
+ * Prints the delays measured by the trials of a latency search by increasing
+ * rate, marking the knee of the curve, i.e. the highest rate meeting the
+ * target (if any).
+ * */
+static void search_report_curve(struct config *conf,
+                                const struct search_trial trials[],
+                                unsigned int nb_trials, rate_t rate) {
+    struct search_trial sorted[SEARCH_MAX_TRIALS];
+
+    memcpy(sorted, trials, sizeof(*trials) * nb_trials);
+    qsort(sorted, nb_trials, sizeof(*sorted), search_trial_cmp);
+
+    printf("LATENCY VS LOAD\n");
+    printf("rate (pps)\tp%g (us)\n", conf->search.percentile);
+
+    for (unsigned int i = 0; i < nb_trials; ++i)
+        printf("%lu\t\t%f%s\n", sorted[i].rate, sorted[i].delay_us,
+               sorted[i].pass && sorted[i].rate == rate ? " <- knee" : "");
+}
+
+static void search_report(struct config *conf, struct search *search,
+                          struct search_trial trials[], unsigned int nb_trials,
+                          rate_t rate, double elapsed) {
+    printf("-------------------------------------\n");
+    printf("RATE SEARCH\n");
+    printf("trial\trate (pps)\ttx\t\trx\t\tloss (%%)");
+    if (search->latency)
+        printf("\tp%g (us)", conf->search.percentile);
+    printf("\n");
+
+    for (unsigned int i = 0; i < nb_trials; ++i) {
+        printf("%u\t%lu\t\t%lu\t\t%lu\t\t%f", i + 1, trials[i].rate,
+               trials[i].tx, trials[i].rx, trials[i].loss * 100.);
+        if (search->latency)
+            printf("\t%f", trials[i].delay_us);
+        printf(" %s\n", trials[i].pass ? "pass" : "fail");
+    }
+
+    if (search->latency)
+        search_report_curve(conf, trials, nb_trials, rate);
+
+    printf("max loss (%%)\t%f\n", conf->search.max_loss * 100.);
+    if (search->latency)
+        printf("max p%g (us)\t%f\n", conf->search.percentile,
+               conf->search.max_delay_us);
+    printf("rate (pps)\t%lu\n", rate);
+    printf("total (pps)\t%lu\n", rate * conf->num_threads);
+    printf("trials\t\t%u\n", nb_trials);
+    printf("elapsed (s)\t%.1f\n", elapsed);
+}
+
+/**
+ * Binary-searches the highest per-thread rate, up to the configured one, at
+ * which the fraction of lost packets does not exceed the configured
+ * threshold (nor the configured percentile of round-trip delays the
+ * configured target, in latency searches), then terminates the application.
+ * */
+static __attribute__((noreturn)) void search_drive(struct config *conf,
+                                                   struct search *search) {
+    struct search_trial trials[SEARCH_MAX_TRIALS];
+    const rate_t resolution = conf->rate * SEARCH_RESOLUTION;
+    rate_t lo = 0, hi = conf->rate;
+    rate_t rate = conf->rate;
+    unsigned int nb_trials = 0;
+    struct timespec start, end;
+    FILE *in = NULL;
+
+    if (!search->latency)
+        in = search_connect(search);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // If the maximum rate passes, there is nothing to search
+    do {
+        struct search_trial *trial = &trials[nb_trials++];
+
+        trial->rate = rate;
+        search_trial_run(conf, search, in, trial);
+
+        if (!conf->silent && search->latency)
+            printf("Trial %u: %lu pps, loss %f%%, p%g %f us (%s)\n",
+                   nb_trials, trial->rate, trial->loss * 100.,
+                   conf->search.percentile, trial->delay_us,
+                   trial->pass ? "pass" : "fail");
+        else if (!conf->silent)
+            printf("Trial %u: %lu pps, loss %f%% (%s)\n", nb_trials,
+                   trial->rate, trial->loss * 100.,
+                   trial->pass ? "pass" : "fail");
+
+        if (trial->pass)
+            lo = trial->rate;
+        else
+            hi = trial->rate;
+
+        rate = lo + (hi - lo) / 2;
+    } while (lo < conf->rate && hi - lo > resolution && hi - lo > 1 &&
+             nb_trials < SEARCH_MAX_TRIALS);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (!search->latency) {
+        dprintf(search->fd, "QUIT\n");
+        fclose(in);
+    }
+
+    search_report(conf, search, trials, nb_trials, lo,
+                  (end.tv_sec - start.tv_sec) +
+                      (end.tv_nsec - start.tv_nsec) / (double)NSEC_PER_SEC);
+
+    exit(EXIT_SUCCESS);
+}
+
+/**
+ * Serves the requests of the sender on the control channel until the search
+ * is over, then terminates the application.
+ * */
+static __attribute__((noreturn)) void search_respond(struct search *search) {
+    char line[SEARCH_LINE_SIZE];
+    uint64_t rx = 0;
+    FILE *in;
+    int fd;
+
+    fd = accept(search->fd, NULL, NULL);
+    if (fd < 0) {
+        PRINT_SEARCH_ERROR("could not accept control connection");
+        exit(EXIT_FAILURE);
+    }
+
+    in = fdopen(fd, "r");
+    if (in == NULL) {
+        PRINT_SEARCH_ERROR("could not open control channel");
+        exit(EXIT_FAILURE);
+    }
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (strcmp(line, "START\n") == 0) {
+            rx = search_total(search->rx, search->nb_slots);
+            dprintf(fd, "OK\n");
+        } else if (strcmp(line, "STOP\n") == 0) {
+            dprintf(fd, "RX %lu\n",
+                    search_total(search->rx, search->nb_slots) - rx);
+        } else if (strcmp(line, "QUIT\n") == 0) {
+            printf("-------------------------------------\n");
+            printf("RATE SEARCH\n");
+            printf("completed by the sender\n");
+            exit(EXIT_SUCCESS);
+        } else {
+            break;
+        }
+    }
+
+    fprintf(stderr, "SEARCH ERROR: control channel closed\n");
+    exit(EXIT_FAILURE);
+}
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+/**
+ * Prepares the rate search given in the configuration, if any, given whether
+ * the application runs loops that only send packets and client ones. In loss
+ * searches the receiving side starts listening on the control channel right
+ * away, so that the sender can connect to it as soon as it is started.
+ *
+ * Shall be invoked before per-thread copies of the configuration are made.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+int search_init(struct config *conf, bool senders, bool clients) {
+    struct search *search;
+    const int one = 1;
+
+    if (conf->search.ctrl == NULL && conf->search.max_delay_us == 0)
+        return 0;
+
+    search = aligned_alloc(RTE_CACHE_LINE_SIZE, sizeof(*search));
+    if (search == NULL) {
+        PRINT_SEARCH_ERROR("could not allocate search");
+        return -1;
+    }
+
+    memset(search, 0, sizeof(*search));
+    search->latency = conf->search.max_delay_us > 0;
+    search->controller = senders || clients;
+    search->senders = senders;
+    search->nb_slots = conf->num_threads;
+    search->fd = -1;
+
+    // No control channel is needed: the client measures delays by itself
+    if (search->latency) {
+        for (unsigned int i = 0; i < search->nb_slots; ++i) {
+            search->rx[i].delays = aligned_alloc(
+                RTE_CACHE_LINE_SIZE,
+                RTE_ALIGN_CEIL(sizeof(struct histogram), RTE_CACHE_LINE_SIZE));
+            if (search->rx[i].delays == NULL) {
+                PRINT_SEARCH_ERROR("could not allocate delays");
+                goto error_free;
+            }
+
+            histogram_reset(search->rx[i].delays);
+        }
+
+        conf->search.search = search;
+        return 0;
+    }
+
+    if (search_addr_parse(conf->search.ctrl, &search->addr)) {
+        fprintf(stderr, "SEARCH ERROR: invalid control address %s\n",
+                conf->search.ctrl);
+        goto error_free;
+    }
+
+    if (!search->controller) {
+        search->fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (search->fd < 0) {
+            PRINT_SEARCH_ERROR("could not create control socket");
+            goto error_free;
+        }
+
+        setsockopt(search->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        if (bind(search->fd, (struct sockaddr *)&search->addr,
+                 sizeof(search->addr)) ||
+            listen(search->fd, 1)) {
+            PRINT_SEARCH_ERROR("could not listen on control address");
+            goto error_close;
+        }
+    }
+
+    conf->search.search = search;
+    return 0;
+
+error_close:
+    close(search->fd);
+error_free:
+    for (unsigned int i = 0; i < search->nb_slots; ++i)
+        free(search->rx[i].delays);
+    free(search);
+    return -1;
+}
+
+/**
+ * Returns the slot the thread owning the given configuration shall count the
+ * packets it sends in, NULL if no search is running.
+ * */
+struct search_slot *search_tx_attach(struct config *conf) {
+    if (conf->search.search == NULL)
+        return NULL;
+
+    return &conf->search.search->tx[conf->thread_id];
+}
+
+/**
+ * Returns the slot the thread owning the given configuration shall count the
+ * packets it receives in (and record their delays, in latency searches), NULL
+ * if no search is running.
+ * */
+struct search_slot *search_rx_attach(struct config *conf) {
+    if (conf->search.search == NULL)
+        return NULL;
+
+    return &conf->search.search->rx[conf->thread_id];
+}
+
+/**
+ * Runs the search, driving it on the sending (or client) side and answering
+ * the requests of the sender on the receiving one. Never returns: the
+ * application is terminated once the search is over.
+ * */
+void search_run(struct config *conf) {
+    struct search *search = conf->search.search;
+
+    if (search->controller)
+        search_drive(conf, search);
+    else
+        search_respond(search);
+}
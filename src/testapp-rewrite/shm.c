@@ -0,0 +1,188 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <sys/mman.h>
+
+#include "shm.h"
+
+/* ------------------------------- Constants -------------------------------- */
+
+#define PRINT_SHM_ERROR(str) perror("SHM ERROR: " str)
+
+/* Byte ranges of the shared file used as locks: the first one serializes
+ * applications attaching to the region, the second one is held (shared) by
+ * each application for its whole lifetime */
+#define SHM_LOCK_INIT 0
+#define SHM_LOCK_USERS 1
+
+/* --------------------------- Private Functions ---------------------------- */
+
+/**
+ * Acquires (or tests) a lock on a single byte of the shared file. Open file
+ * description locks are released automatically when the application
+ * terminates, even abnormally.
+ *
+ * \return the fcntl result.
+ * */
+static inline int shm_lock(int fd, int cmd, short type, off_t which,
+                           struct flock *fl) {
+    memset(fl, 0, sizeof(*fl));
+    fl->l_type = type;
+    fl->l_whence = SEEK_SET;
+    fl->l_start = which;
+    fl->l_len = 1;
+    return fcntl(fd, cmd, fl);
+}
+
+/**
+ * Tells whether this application produces on the first ring. The choice only
+ * depends on the pair of addresses, so that the two applications always pick
+ * opposite rings.
+ * */
+static inline int shm_direction(struct config *conf) {
+    uint32_t local_ip = ntohl(conf->local.ip.sin_addr.s_addr);
+    uint32_t remote_ip = ntohl(conf->remote.ip.sin_addr.s_addr);
+    uint16_t local_port = ntohs(conf->local.ip.sin_port);
+    uint16_t remote_port = ntohs(conf->remote.ip.sin_port);
+
+    if (local_ip != remote_ip)
+        return local_ip < remote_ip ? 0 : 1;
+    if (local_port != remote_port)
+        return local_port < remote_port ? 0 : 1;
+
+    return -1;
+}
+
+/**
+ * Resets the region: rings are empty and the n-th descriptor of each ring
+ * references a different buffer of the pool.
+ * */
+static inline void shm_region_reset(struct shm_region *region) {
+    region->magic = 0;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    region->version = SHM_VERSION;
+    region->ring_size = SHM_RING_SIZE;
+    region->buf_size = SHM_BUF_SIZE;
+
+    for (uint32_t r = 0; r < 2; ++r) {
+        region->rings[r].head = 0;
+        region->rings[r].tail = 0;
+        for (uint32_t i = 0; i < SHM_RING_SIZE; ++i) {
+            region->rings[r].desc[i].buf = r * SHM_RING_SIZE + i;
+            region->rings[r].desc[i].len = 0;
+        }
+    }
+
+    __atomic_store_n(&region->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+}
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+/**
+ * Maps the shared file given in the configuration, creating and initializing
+ * it if this is the first application attaching to it.
+ *
+ * The file is meant to reside on a hugetlbfs mount shared by the two
+ * applications (e.g. a directory bind-mounted in two containers), but any
+ * file system supporting shared mappings works.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+int shm_init(struct config *conf) {
+    struct shm_channel *chan;
+    struct flock fl;
+    int direction;
+    bool first;
+
+    direction = shm_direction(conf);
+    if (direction < 0) {
+        fprintf(stderr, "SHM ERROR: local and remote addresses must differ\n");
+        return -1;
+    }
+
+    chan = malloc(sizeof(*chan));
+    if (chan == NULL) {
+        PRINT_SHM_ERROR("could not allocate channel");
+        return -1;
+    }
+
+    chan->map_size = (sizeof(struct shm_region) + SHM_HUGEPAGE_SIZE - 1) &
+                     ~(SHM_HUGEPAGE_SIZE - 1);
+
+    chan->fd = open(conf->shm.path, O_RDWR | O_CREAT, 0666);
+    if (chan->fd < 0) {
+        PRINT_SHM_ERROR("could not open shared file");
+        goto error_free;
+    }
+
+    if (shm_lock(chan->fd, F_OFD_SETLKW, F_WRLCK, SHM_LOCK_INIT, &fl)) {
+        PRINT_SHM_ERROR("could not lock shared file");
+        goto error_close;
+    }
+
+    // Nobody else is using the region if the users lock could be taken
+    // exclusively
+    if (shm_lock(chan->fd, F_OFD_GETLK, F_WRLCK, SHM_LOCK_USERS, &fl)) {
+        PRINT_SHM_ERROR("could not test shared file lock");
+        goto error_close;
+    }
+    first = fl.l_type == F_UNLCK;
+
+    if (first && ftruncate(chan->fd, chan->map_size)) {
+        PRINT_SHM_ERROR("could not resize shared file");
+        goto error_close;
+    }
+
+    chan->region = mmap(NULL, chan->map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, chan->fd, 0);
+    if (chan->region == MAP_FAILED) {
+        PRINT_SHM_ERROR("could not map shared file");
+        goto error_close;
+    }
+
+    // Whatever was left by previous runs is discarded
+    if (first)
+        shm_region_reset(chan->region);
+
+    if (chan->region->magic != SHM_MAGIC ||
+        chan->region->version != SHM_VERSION ||
+        chan->region->ring_size != SHM_RING_SIZE ||
+        chan->region->buf_size != SHM_BUF_SIZE) {
+        fprintf(stderr, "SHM ERROR: shared file has an incompatible layout\n");
+        goto error_unmap;
+    }
+
+    if (shm_lock(chan->fd, F_OFD_SETLK, F_RDLCK, SHM_LOCK_USERS, &fl) ||
+        shm_lock(chan->fd, F_OFD_SETLK, F_UNLCK, SHM_LOCK_INIT, &fl)) {
+        PRINT_SHM_ERROR("could not lock shared file");
+        goto error_unmap;
+    }
+
+    chan->tx = &chan->region->rings[direction];
+    chan->rx = &chan->region->rings[1 - direction];
+
+    conf->shm.chan = chan;
+    return 0;
+
+error_unmap:
+    munmap(chan->region, chan->map_size);
+error_close:
+    // Closing the file releases all the locks
+    close(chan->fd);
+error_free:
+    free(chan);
+    return -1;
+}
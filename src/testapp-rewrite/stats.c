@@ -1,11 +1,79 @@
+#include <rte_common.h>
+
 #include "stats.h"
 
 #define STATS_SIZE 64
 #define STATS_INDEX_MASK 0x3F
 
+#define USEC_PER_SEC 1000000.
+
 const struct stats STATS_INIT = {
     .type = STATS_TX, .first = 0, .last = 0, .count = 0};
 
+const double stats_percentiles[STATS_PERCENTILES] = {50, 90, 99, 99.9, 99.99};
+
+static inline double stats_us(tsc_t tsc) {
+    return tsc / (double)tsc_get_hz() * USEC_PER_SEC;
+}
+
+/**
+ * Summarizes the delays counted in the given histogram, leaving the count of
+ * outliers untouched.
+ * */
+static void stats_summarize_delay(struct stats_data_delay *d,
+                                  const struct histogram *h) {
+    d->num = h->total;
+    d->avg = h->total ? h->sum / h->total : 0;
+    d->min = h->min;
+    d->max = h->max;
+
+    for (int i = 0; i < STATS_PERCENTILES; ++i)
+        d->percentiles[i] = histogram_percentile(h, stats_percentiles[i]);
+}
+
+/**
+ * Merges the delays of the same period of two threads. Percentiles cannot be
+ * merged exactly once summarized: the highest one is kept, so that they are
+ * never underestimated (exact percentiles of all threads are the cumulative
+ * ones).
+ * */
+static void stats_merge_delay(struct stats_data_delay *dst,
+                              const struct stats_data_delay *src) {
+    dst->outliers += src->outliers;
+
+    if (src->num == 0)
+        return;
+
+    if (dst->num == 0) {
+        uint64_t outliers = dst->outliers;
+
+        *dst = *src;
+        dst->outliers = outliers;
+        return;
+    }
+
+    // Averages are weighted by the number of packets
+    dst->avg = ((uint64_t)dst->avg * dst->num + (uint64_t)src->avg * src->num) /
+               (dst->num + src->num);
+    dst->num += src->num;
+    dst->min = RTE_MIN(dst->min, src->min);
+    dst->max = RTE_MAX(dst->max, src->max);
+
+    for (int i = 0; i < STATS_PERCENTILES; ++i)
+        dst->percentiles[i] = RTE_MAX(dst->percentiles[i], src->percentiles[i]);
+}
+
+void stats_print_delay(const char *label, const struct stats_data_delay *d) {
+    printf("%s (us) avg min", label);
+    for (int i = 0; i < STATS_PERCENTILES; ++i)
+        printf(" p%g", stats_percentiles[i]);
+    printf(" max, rx count and outliers: %f %f", stats_us(d->avg),
+           stats_us(d->min));
+    for (int i = 0; i < STATS_PERCENTILES; ++i)
+        printf(" %f", stats_us(d->percentiles[i]));
+    printf(" %f %lu %lu\n", stats_us(d->max), d->num, d->outliers);
+}
+
 void stats_save(struct stats *s, union stats_data *d) {
     if (s->count < STATS_SIZE) {
         // Fill up, s->first will remain equal to zero until filled
@@ -22,6 +90,21 @@ void stats_save(struct stats *s, union stats_data *d) {
     }
 }
 
+/**
+ * Saves the delays counted in the given histogram as a new period, summarizing
+ * them in d (whose outliers shall be already counted), and adds them to the
+ * delays measured so far.
+ * */
+void stats_save_delay(struct stats *s, struct stats_data_delay *d,
+                      const struct histogram *h) {
+    stats_summarize_delay(d, h);
+
+    histogram_merge(&s->delays, h);
+    s->outliers += d->outliers;
+
+    stats_save(s, (union stats_data *)d);
+}
+
 void stats_print_all(struct stats *s) {
     if (!s->count) {
         // atomic_flag_clear(&s->in_use);
@@ -37,4 +120,47 @@ void stats_print_all(struct stats *s) {
     if (s->count == STATS_SIZE) {
         stats_print(s->type, &s->data[s->last]);
     }
+
+    // Percentiles of the whole test, exact even for merged stats
+    if (s->type == STATS_DELAY) {
+        struct stats_data_delay total = {.outliers = s->outliers};
+
+        stats_summarize_delay(&total, &s->delays);
+        stats_print_delay("Total delay", &total);
+    }
+}
+
+/**
+ * Adds the periods saved in src to the ones saved in dst, so that the stats
+ * of many threads running the same loop can be printed as a whole. Periods
+ * are matched by age, starting from the oldest one; stats of different types
+ * are not merged. Delays measured so far are merged exactly.
+ * */
+void stats_merge(struct stats *dst, const struct stats *src) {
+    if (dst->type != src->type)
+        return;
+
+    for (int n = 0; n < dst->count && n < src->count; ++n) {
+        union stats_data *d = &dst->data[(dst->first + n) & STATS_INDEX_MASK];
+        const union stats_data *s =
+            &src->data[(src->first + n) & STATS_INDEX_MASK];
+
+        switch (dst->type) {
+        case STATS_TX:
+            d->t.tx += s->t.tx;
+            d->t.dropped += s->t.dropped;
+            break;
+        case STATS_RX:
+            d->r.rx += s->r.rx;
+            break;
+        case STATS_DELAY:
+            stats_merge_delay(&d->d, &s->d);
+            break;
+        }
+    }
+
+    if (dst->type == STATS_DELAY) {
+        histogram_merge(&dst->delays, &src->delays);
+        dst->outliers += src->outliers;
+    }
 }
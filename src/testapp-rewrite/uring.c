@@ -0,0 +1,239 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#include "uring.h"
+
+/* ------------------------------- Constants -------------------------------- */
+
+#define PRINT_URING_ERROR(str) perror("IO_URING ERROR: " str)
+
+/**
+ * Setup flags to be tried in order. Deferred task running lets the
+ * application decide when completions are posted, avoiding interrupts while
+ * busy polling; older kernels fall back to cooperative task running and then
+ * to the default behavior.
+ * */
+static const uint32_t URING_SETUP_FLAGS[] = {
+    IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN |
+        IORING_SETUP_TASKRUN_FLAG,
+    IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG,
+    0,
+};
+
+/* --------------------------- Private Functions ---------------------------- */
+
+static inline int sys_io_uring_setup(uint32_t entries,
+                                     struct io_uring_params *p) {
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int sys_io_uring_register(int fd, uint32_t opcode, void *arg,
+                                        uint32_t nr_args) {
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/**
+ * Maps submission and completion queues in memory.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+static inline int uring_mmap(struct uring *r, struct io_uring_params *p) {
+    uint8_t *sq;
+    uint8_t *cq;
+    uint32_t *array;
+
+    r->sq_map_size = p->sq_off.array + p->sq_entries * sizeof(uint32_t);
+    r->cq_map_size =
+        p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_map_size > r->sq_map_size)
+            r->sq_map_size = r->cq_map_size;
+        r->cq_map_size = r->sq_map_size;
+    }
+
+    r->sq_map = mmap(NULL, r->sq_map_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_map == MAP_FAILED)
+        return -1;
+
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_map = r->sq_map;
+    } else {
+        r->cq_map = mmap(NULL, r->cq_map_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_map == MAP_FAILED)
+            return -1;
+    }
+
+    r->sqes = mmap(NULL, p->sq_entries * sizeof(struct io_uring_sqe),
+                   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd,
+                   IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED)
+        return -1;
+
+    sq = r->sq_map;
+    cq = r->cq_map;
+    array = (uint32_t *)(sq + p->sq_off.array);
+
+    r->sq_head = (uint32_t *)(sq + p->sq_off.head);
+    r->sq_tail = (uint32_t *)(sq + p->sq_off.tail);
+    r->sq_flags = (uint32_t *)(sq + p->sq_off.flags);
+    r->sq_mask = *(uint32_t *)(sq + p->sq_off.ring_mask);
+    r->sq_entries = *(uint32_t *)(sq + p->sq_off.ring_entries);
+
+    r->cq_head = (uint32_t *)(cq + p->cq_off.head);
+    r->cq_tail = (uint32_t *)(cq + p->cq_off.tail);
+    r->cq_mask = *(uint32_t *)(cq + p->cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p->cq_off.cqes);
+
+    // SQEs are always submitted in order, so the indirection array is
+    // an identity mapping that never changes
+    for (uint32_t i = 0; i < r->sq_entries; ++i)
+        array[i] = i;
+
+    r->sqe_tail = *r->sq_tail;
+    r->sqe_submitted = r->sqe_tail;
+
+    return 0;
+}
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+/**
+ * Creates a new io_uring instance with the given number of submission queue
+ * entries.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+int uring_init(struct uring *r, uint32_t entries) {
+    struct io_uring_params p;
+    size_t i;
+
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+
+    for (i = 0; i < sizeof(URING_SETUP_FLAGS) / sizeof(URING_SETUP_FLAGS[0]);
+         ++i) {
+        memset(&p, 0, sizeof(p));
+        p.flags = URING_SETUP_FLAGS[i];
+
+        r->fd = sys_io_uring_setup(entries, &p);
+        if (r->fd >= 0 || errno != EINVAL)
+            break;
+    }
+
+    if (r->fd < 0) {
+        PRINT_URING_ERROR("could not set up ring");
+        return -1;
+    }
+
+    r->flags = p.flags;
+
+    if (uring_mmap(r, &p)) {
+        PRINT_URING_ERROR("could not map ring");
+        close(r->fd);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Wrapper around the io_uring_enter system call.
+ *
+ * \return the number of SQEs consumed, a negative number on error.
+ * */
+int uring_enter(struct uring *r, uint32_t to_submit, uint32_t min_complete,
+                uint32_t flags) {
+    return syscall(__NR_io_uring_enter, r->fd, to_submit, min_complete, flags,
+                   NULL, 0);
+}
+
+/**
+ * Submits all the SQEs prepared so far with a single system call, also
+ * running any pending kernel work so that new completions are posted.
+ *
+ * \return the number of SQEs submitted, a negative number on error.
+ * */
+int uring_submit(struct uring *r) {
+    uint32_t to_submit = uring_flush_sq(r);
+    uint32_t flags = 0;
+
+    if (uring_needs_enter(r))
+        flags |= IORING_ENTER_GETEVENTS;
+
+    if (to_submit == 0 && flags == 0)
+        return 0;
+
+    return uring_enter(r, to_submit, 0, flags);
+}
+
+/**
+ * Registers the given memory areas as fixed buffers, so that the kernel does
+ * not need to map them on each operation. Each area is then identified by its
+ * index in the array.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+int uring_register_buffers(struct uring *r, const struct iovec *iovs,
+                           uint32_t howmany) {
+    if (sys_io_uring_register(r->fd, IORING_REGISTER_BUFFERS, (void *)iovs,
+                              howmany) < 0) {
+        PRINT_URING_ERROR("could not register buffers");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Allocates and registers a ring of provided buffers with the given group
+ * id. The ring is initially empty.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+int uring_buf_ring_init(struct uring *r, struct uring_buf_ring *b,
+                        uint32_t entries, uint16_t bgid) {
+    struct io_uring_buf_reg reg;
+    size_t size = entries * sizeof(struct io_uring_buf);
+
+    b->br = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (b->br == MAP_FAILED) {
+        PRINT_URING_ERROR("could not allocate buffer ring");
+        return -1;
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)b->br;
+    reg.ring_entries = entries;
+    reg.bgid = bgid;
+
+    if (sys_io_uring_register(r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        PRINT_URING_ERROR("could not register buffer ring");
+        return -1;
+    }
+
+    b->bgid = bgid;
+    b->tail = 0;
+    b->mask = entries - 1;
+    b->entries = entries;
+    b->br->tail = 0;
+
+    return 0;
+}
@@ -0,0 +1,482 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+/* -------------------------------- Includes -------------------------------- */
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "config.h"
+#include "hdr_tools.h"
+#include "xdp.h"
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+/* ------------------------------- Constants -------------------------------- */
+
+#define PRINT_XDP_ERROR(str) perror("XDP ERROR: " str)
+
+/**
+ * Initializers for the few eBPF instructions needed by the redirect program,
+ * equivalent to the ones in the kernel tools/include/linux/filter.h.
+ * */
+#define BPF_INSN(c, d, s, o, i)                                                \
+    ((struct bpf_insn){                                                        \
+        .code = (c), .dst_reg = (d), .src_reg = (s), .off = (o), .imm = (i)})
+
+/* --------------------------- Private Functions ---------------------------- */
+
+/**
+ * Counts the receive queues of the given interface, as listed in sysfs.
+ *
+ * \return the number of queues, 0 if it cannot be told.
+ * */
+static unsigned int xdp_rx_queues(const char *ifname) {
+    char path[PATH_MAX];
+    unsigned int count = 0;
+    struct dirent *entry;
+    DIR *dir;
+
+    snprintf(path, sizeof(path), "/sys/class/net/%s/queues", ifname);
+
+    dir = opendir(path);
+    if (dir == NULL)
+        return 0;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "rx-", 3) == 0)
+            ++count;
+    }
+
+    closedir(dir);
+    return count;
+}
+
+static inline int sys_bpf(enum bpf_cmd cmd, union bpf_attr *attr) {
+    return syscall(SYS_bpf, cmd, attr, sizeof(*attr));
+}
+
+/**
+ * Creates the XSKMAP used to redirect frames to the AF_XDP socket, with one
+ * entry per interface queue up to the given one, since the XDP program looks
+ * sockets up by queue index.
+ *
+ * \return the map file descriptor, a negative number on error.
+ * */
+static inline int xdp_map_create(uint32_t queue_id) {
+    union bpf_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(int);
+    attr.value_size = sizeof(int);
+    attr.max_entries = queue_id + 1;
+
+    return sys_bpf(BPF_MAP_CREATE, &attr);
+}
+
+static inline int xdp_map_update(int map_fd, int key, int value) {
+    union bpf_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = map_fd;
+    attr.key = (uint64_t)(uintptr_t)&key;
+    attr.value = (uint64_t)(uintptr_t)&value;
+    attr.flags = BPF_ANY;
+
+    return sys_bpf(BPF_MAP_UPDATE_ELEM, &attr);
+}
+
+/**
+ * Loads an XDP program equivalent to:
+ *
+ *     return bpf_redirect_map(&xsks_map, ctx->rx_queue_index, XDP_PASS);
+ *
+ * Frames received on queues without a socket are passed to the kernel stack.
+ *
+ * \return the program file descriptor, a negative number on error.
+ * */
+static inline int xdp_prog_load(int map_fd) {
+    const struct bpf_insn insns[] = {
+        /* r2 = ctx->rx_queue_index */
+        BPF_INSN(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_1,
+                 offsetof(struct xdp_md, rx_queue_index), 0),
+        /* r1 = &xsks_map (64 bit immediate, two instructions) */
+        BPF_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0,
+                 map_fd),
+        BPF_INSN(0, 0, 0, 0, 0),
+        /* r3 = XDP_PASS */
+        BPF_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS),
+        /* r0 = bpf_redirect_map(r1, r2, r3) */
+        BPF_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map),
+        BPF_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+    };
+
+    static const char license[] = "GPL";
+    union bpf_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns = (uint64_t)(uintptr_t)insns;
+    attr.insn_cnt = sizeof(insns) / sizeof(insns[0]);
+    attr.license = (uint64_t)(uintptr_t)license;
+
+    return sys_bpf(BPF_PROG_LOAD, &attr);
+}
+
+/**
+ * Attaches the XDP program to the interface, trying native (driver) mode
+ * first and generic (skb) mode afterwards. The program stays attached until
+ * the returned link file descriptor is closed (i.e. until the process exits).
+ *
+ * \return the link file descriptor, a negative number on error.
+ * */
+static inline int xdp_prog_attach(int prog_fd, int ifindex) {
+    const uint32_t modes[] = {XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE};
+    union bpf_attr attr;
+    int res = -1;
+
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]) && res < 0; ++i) {
+        memset(&attr, 0, sizeof(attr));
+        attr.link_create.prog_fd = prog_fd;
+        attr.link_create.target_ifindex = ifindex;
+        attr.link_create.attach_type = BPF_XDP;
+        attr.link_create.flags = modes[i];
+
+        res = sys_bpf(BPF_LINK_CREATE, &attr);
+    }
+
+    return res;
+}
+
+/**
+ * Maps one of the rings of the socket into the application address space.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+static inline int xdp_ring_mmap(int fd, struct xdp_ring *r,
+                                const struct xdp_ring_offset *off,
+                                size_t desc_size, uint64_t pgoff,
+                                bool is_producer) {
+    size_t len = off->desc + XDP_RING_SIZE * desc_size;
+
+    byte_t *map = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, pgoff);
+    if (map == MAP_FAILED)
+        return -1;
+
+    r->mask = XDP_RING_SIZE - 1;
+    r->size = XDP_RING_SIZE;
+    r->producer = (uint32_t *)(map + off->producer);
+    r->consumer = (uint32_t *)(map + off->consumer);
+    r->flags = (uint32_t *)(map + off->flags);
+    r->ring = map + off->desc;
+    r->map = map;
+    r->map_len = len;
+    r->cached_prod = *r->producer;
+    r->cached_cons = *r->consumer;
+
+    // Rings the application produces to start completely free
+    if (is_producer)
+        r->cached_cons += r->size;
+
+    return 0;
+}
+
+/**
+ * Allocates the UMEM area, preferring hugepages when available.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+static inline int xdp_umem_alloc(struct xdp_socket *xsk) {
+    xsk->umem_size = (size_t)XDP_NUM_FRAMES * XDP_FRAME_SIZE;
+
+    xsk->umem_area =
+        mmap(NULL, xsk->umem_size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+
+    if (xsk->umem_area == MAP_FAILED)
+        xsk->umem_area =
+            mmap(NULL, xsk->umem_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+
+    if (xsk->umem_area == MAP_FAILED) {
+        xsk->umem_area = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Binds the socket to the given interface queue, trying zero-copy mode first
+ * and falling back to copy mode if the driver does not support it.
+ *
+ * \return 0 on success, -1 otherwise.
+ * */
+static inline int xdp_bind(struct xdp_socket *xsk, int ifindex,
+                           uint32_t queue_id) {
+    const uint16_t modes[] = {
+        XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP,
+        XDP_COPY | XDP_USE_NEED_WAKEUP,
+        XDP_COPY,
+    };
+
+    struct sockaddr_xdp sxdp;
+    int res = -1;
+
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]) && res < 0; ++i) {
+        memset(&sxdp, 0, sizeof(sxdp));
+        sxdp.sxdp_family = AF_XDP;
+        sxdp.sxdp_ifindex = ifindex;
+        sxdp.sxdp_queue_id = queue_id;
+        sxdp.sxdp_flags = modes[i];
+
+        res = bind(xsk->fd, (struct sockaddr *)&sxdp, sizeof(sxdp));
+        if (res == 0) {
+            xsk->zerocopy = (modes[i] & XDP_ZEROCOPY) != 0;
+            xsk->need_wakeup = (modes[i] & XDP_USE_NEED_WAKEUP) != 0;
+        }
+    }
+
+    return res;
+}
+
+/**
+ * Releases everything allocated for the socket so far, on initialization
+ * errors. File descriptors not opened yet shall be negative.
+ * */
+static void xdp_socket_free(struct xdp_socket *xsk) {
+    struct xdp_ring *rings[] = {&xsk->fill, &xsk->comp, &xsk->rx, &xsk->tx};
+
+    if (xsk->link_fd >= 0)
+        close(xsk->link_fd);
+    if (xsk->prog_fd >= 0)
+        close(xsk->prog_fd);
+    if (xsk->map_fd >= 0)
+        close(xsk->map_fd);
+
+    for (size_t i = 0; i < sizeof(rings) / sizeof(rings[0]); ++i) {
+        if (rings[i]->map != NULL)
+            munmap(rings[i]->map, rings[i]->map_len);
+    }
+
+    if (xsk->fd >= 0)
+        close(xsk->fd);
+    if (xsk->umem_area != NULL)
+        munmap(xsk->umem_area, xsk->umem_size);
+
+    free(xsk->tx_frames);
+    free(xsk);
+}
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+/**
+ * Initialize an AF_XDP socket on the interface given by the -X option.
+ *
+ * This function creates the UMEM area and all the rings associated with the
+ * socket, then loads and attaches an XDP program that redirects frames from
+ * the selected interface queue to the new socket.
+ *
+ * \return 0 on success, an error code otherwise.
+ * */
+int xdp_init(struct config *conf) {
+    struct xdp_socket *xsk;
+    struct xdp_umem_reg umem_reg;
+    struct xdp_mmap_offsets off;
+    socklen_t optlen;
+    unsigned int nb_queues;
+    int ifindex;
+    int ring_size = XDP_RING_SIZE;
+    int res;
+
+    ifindex = if_nametoindex(conf->local_interf);
+    if (ifindex == 0) {
+        PRINT_XDP_ERROR("unknown interface");
+        return -1;
+    }
+
+    /* Frames received on other queues are passed to the kernel, hence they
+     * would silently be missing from the counts */
+    nb_queues = xdp_rx_queues(conf->local_interf);
+    if (nb_queues > 0 && conf->xdp.queue_id >= nb_queues) {
+        fprintf(stderr, "XDP ERROR: %s has no queue %u (%u queues)\n",
+                conf->local_interf, conf->xdp.queue_id, nb_queues);
+        return -1;
+    }
+
+    if (nb_queues > 1)
+        fprintf(stderr,
+                "XDP WARNING: %s has %u receive queues, only packets of "
+                "queue %u are received; steer the test flows to it (ethtool "
+                "-N %s) or use one queue (ethtool -L %s combined 1)\n",
+                conf->local_interf, nb_queues, conf->xdp.queue_id,
+                conf->local_interf, conf->local_interf);
+
+    xsk = calloc(1, sizeof(struct xdp_socket));
+    if (xsk == NULL) {
+        PRINT_XDP_ERROR("could not allocate socket");
+        return -1;
+    }
+
+    xsk->map_fd = xsk->prog_fd = xsk->link_fd = -1;
+
+    xsk->fd = socket(AF_XDP, SOCK_RAW, 0);
+    if (xsk->fd < 0) {
+        PRINT_XDP_ERROR("could not create socket");
+        goto error;
+    }
+
+    if (xdp_umem_alloc(xsk)) {
+        PRINT_XDP_ERROR("could not allocate UMEM area");
+        goto error;
+    }
+
+    /* Register the UMEM area and set the size of each ring */
+    memset(&umem_reg, 0, sizeof(umem_reg));
+    umem_reg.addr = (uint64_t)(uintptr_t)xsk->umem_area;
+    umem_reg.len = xsk->umem_size;
+    umem_reg.chunk_size = XDP_FRAME_SIZE;
+    umem_reg.headroom = 0;
+
+    res = setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_REG, &umem_reg,
+                     sizeof(umem_reg));
+    if (res < 0) {
+        PRINT_XDP_ERROR("could not register UMEM area");
+        goto error;
+    }
+
+    if (setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size,
+                   sizeof(ring_size)) ||
+        setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size,
+                   sizeof(ring_size)) ||
+        setsockopt(xsk->fd, SOL_XDP, XDP_RX_RING, &ring_size,
+                   sizeof(ring_size)) ||
+        setsockopt(xsk->fd, SOL_XDP, XDP_TX_RING, &ring_size,
+                   sizeof(ring_size))) {
+        PRINT_XDP_ERROR("could not set ring sizes");
+        goto error;
+    }
+
+    /* Map all rings in memory */
+    optlen = sizeof(off);
+    res = getsockopt(xsk->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen);
+    if (res < 0) {
+        PRINT_XDP_ERROR("could not get ring offsets");
+        goto error;
+    }
+
+    if (xdp_ring_mmap(xsk->fd, &xsk->fill, &off.fr, sizeof(uint64_t),
+                      XDP_UMEM_PGOFF_FILL_RING, true) ||
+        xdp_ring_mmap(xsk->fd, &xsk->comp, &off.cr, sizeof(uint64_t),
+                      XDP_UMEM_PGOFF_COMPLETION_RING, false) ||
+        xdp_ring_mmap(xsk->fd, &xsk->rx, &off.rx, sizeof(struct xdp_desc),
+                      XDP_PGOFF_RX_RING, false) ||
+        xdp_ring_mmap(xsk->fd, &xsk->tx, &off.tx, sizeof(struct xdp_desc),
+                      XDP_PGOFF_TX_RING, true)) {
+        PRINT_XDP_ERROR("could not map rings");
+        goto error;
+    }
+
+    /* Hand the first half of the frames to the kernel for reception */
+    uint32_t idx;
+    uint32_t nb = xdp_ring_reserve(&xsk->fill, XDP_RX_FRAMES, &idx);
+    for (uint32_t i = 0; i < nb; ++i)
+        *xdp_ring_addr(&xsk->fill, idx + i) = (uint64_t)i * XDP_FRAME_SIZE;
+    xdp_ring_submit(&xsk->fill, nb);
+
+    /* Keep the second half for outgoing packets */
+    xsk->tx_frames_count = XDP_NUM_FRAMES - XDP_RX_FRAMES;
+    xsk->tx_frames = malloc(sizeof(uint64_t) * xsk->tx_frames_count);
+    if (xsk->tx_frames == NULL) {
+        PRINT_XDP_ERROR("could not allocate outgoing frames");
+        goto error;
+    }
+
+    for (uint32_t i = 0; i < xsk->tx_frames_count; ++i)
+        xsk->tx_frames[i] = (uint64_t)(XDP_RX_FRAMES + i) * XDP_FRAME_SIZE;
+
+    /* Outgoing frames are never overwritten by incoming packets, hence their
+     * header can be written once here instead of once per packet */
+    struct pkt_hdr outgoing_hdr;
+    pkt_hdr_setup(&outgoing_hdr, conf, DIR_OUTGOING);
+
+    for (uint32_t i = 0; i < xsk->tx_frames_count; ++i)
+        rte_memcpy(xsk->umem_area + xsk->tx_frames[i], &outgoing_hdr,
+                   PKT_HEADER_SIZE);
+
+    res = xdp_bind(xsk, ifindex, conf->xdp.queue_id);
+    if (res < 0) {
+        PRINT_XDP_ERROR("could not bind to interface queue");
+        goto error;
+    }
+
+    /* Redirect frames from the interface queue to the socket */
+    xsk->map_fd = xdp_map_create(conf->xdp.queue_id);
+    if (xsk->map_fd < 0) {
+        PRINT_XDP_ERROR("could not create XSKMAP");
+        goto error;
+    }
+
+    res = xdp_map_update(xsk->map_fd, conf->xdp.queue_id, xsk->fd);
+    if (res < 0) {
+        PRINT_XDP_ERROR("could not insert socket in XSKMAP");
+        goto error;
+    }
+
+    xsk->prog_fd = xdp_prog_load(xsk->map_fd);
+    if (xsk->prog_fd < 0) {
+        PRINT_XDP_ERROR("could not load XDP program");
+        goto error;
+    }
+
+    xsk->link_fd = xdp_prog_attach(xsk->prog_fd, ifindex);
+    if (xsk->link_fd < 0) {
+        PRINT_XDP_ERROR("could not attach XDP program to interface");
+        goto error;
+    }
+
+    conf->xdp.xsk = xsk;
+
+    printf("AF_XDP socket bound to %s queue %u (%s mode)\n",
+           conf->local_interf, conf->xdp.queue_id,
+           xsk->zerocopy ? "zero-copy" : "copy");
+
+    return 0;
+
+error:
+    xdp_socket_free(xsk);
+    return -1;
+}
+
+/**
+ * Releases the AF_XDP socket created by xdp_init, along with its UMEM area
+ * and XDP program, e.g. when a socket object using it cannot be created.
+ * */
+void xdp_close(struct config *conf) {
+    if (conf->xdp.xsk == NULL)
+        return;
+
+    xdp_socket_free(conf->xdp.xsk);
+    conf->xdp.xsk = NULL;
+}